@@ -0,0 +1,140 @@
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <driver/i2s.h>
+#endif
+#include "ambient.h"
+
+// Points on the reading to brightness curve, with straight lines between.
+// Readings are 12 bit. Never go all the way to off; the lamp should still
+// look like it's on in a dark room.
+struct curvePoint
+{
+    uint16_t reading;
+    uint8_t brightness;
+};
+
+static const curvePoint ambientCurve[] = {
+    {0, 24},
+    {150, 24},
+    {600, 96},
+    {1800, 200},
+    {3000, 255},
+};
+
+static const int curvePoints = sizeof(ambientCurve) / sizeof(ambientCurve[0]);
+
+static const uint8_t ambientHysteresis = 12;
+
+uint8_t ambientFilter::target() const
+{
+    uint16_t reading = level >> 4;
+    const int last = curvePoints - 1;
+
+    if (reading >= ambientCurve[last].reading)
+        return ambientCurve[last].brightness;
+
+    int i = 0;
+    while (reading >= ambientCurve[i + 1].reading)
+        i++;
+
+    const curvePoint& a = ambientCurve[i];
+    const curvePoint& b = ambientCurve[i + 1];
+    return a.brightness + int32_t(b.brightness - a.brightness) *
+           (reading - a.reading) / (b.reading - a.reading);
+}
+
+void ambientFilter::reset(uint16_t reading)
+{
+    level = uint32_t(reading) << 4;
+    bright = target();
+    moving = false;
+}
+
+uint8_t ambientFilter::add(uint16_t reading)
+{
+    // Exponential moving average, 1/16 of the new reading each time.
+    level += (int32_t(reading << 4) - int32_t(level)) >> 4;
+
+    uint8_t t = target();
+    int diff = int(t) - int(bright);
+    if (!moving && (diff > ambientHysteresis || -diff > ambientHysteresis))
+        moving = true;
+
+    // Once it's decided to move, walk there a step at a time so the change
+    // is a fade rather than a jump.
+    if (moving) {
+        if (diff > 0)
+            bright++;
+        else if (diff < 0)
+            bright--;
+        else
+            moving = false;
+    }
+    return bright;
+}
+
+// The rest is the sampling, which needs the hardware.
+#ifdef ARDUINO
+// Each buffer is averaged into one reading for the filter. At this rate
+// that's 20 readings a second.
+static const int sampleRate = 20000;
+static const int samplesPerBuffer = 1000;
+
+static volatile uint8_t latestBrightness = 255;
+
+static void ambientTask(void*)
+{
+    static uint16_t samples[samplesPerBuffer];
+    ambientFilter filter;
+    bool first = true;
+
+    while (true) {
+        size_t bytes = 0;
+        i2s_read(I2S_NUM_0, samples, sizeof(samples), &bytes, portMAX_DELAY);
+        size_t count = bytes / sizeof(samples[0]);
+        if (count == 0)
+            continue;
+
+        // The top 4 bits of each sample are the channel number.
+        uint32_t sum = 0;
+        for (size_t i = 0; i < count; i++)
+            sum += samples[i] & 0x0fff;
+        uint16_t reading = sum / count;
+
+        if (first) {
+            filter.reset(reading);
+            first = false;
+        }
+        latestBrightness = filter.add(reading);
+    }
+}
+
+void ambientBegin(adc1_channel_t channel)
+{
+    i2s_config_t config = {};
+    config.mode = i2s_mode_t(I2S_MODE_MASTER | I2S_MODE_RX |
+                             I2S_MODE_ADC_BUILT_IN);
+    config.sample_rate = sampleRate;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_I2S_MSB;
+    config.dma_buf_count = 2;
+    config.dma_buf_len = samplesPerBuffer;
+
+    // Only I2S0 can drive the ADC, which leaves I2S1 for the pixels.
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(channel, ADC_ATTEN_DB_11);
+    i2s_driver_install(I2S_NUM_0, &config, 0, nullptr);
+    i2s_set_adc_mode(ADC_UNIT_1, channel);
+    i2s_adc_enable(I2S_NUM_0);
+
+    // Arduino renders on core 1, so sample on core 0.
+    xTaskCreatePinnedToCore(ambientTask, "ambient", 2048, nullptr, 1,
+                            nullptr, 0);
+}
+
+uint8_t ambientBrightness()
+{
+    return latestBrightness;
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#ifdef ARDUINO
+#include <driver/adc.h>
+#endif
+
+// Auto-brightness from an ambient light sensor.
+//
+// The sensor is sampled in the background: the I2S peripheral clocks the ADC
+// and DMAs the samples into memory, and a task on the other core averages
+// each buffer and runs it through an ambientFilter. The render loop only ever
+// reads the latest brightness.
+
+// ambientFilter turns raw sensor readings into an output brightness. It
+// smooths the readings, maps them through ambientCurve, and only moves the
+// brightness once the target is more than ambientHysteresis away, so the
+// lamp doesn't hunt when the room light sits near a step in the curve. It
+// doesn't touch any hardware, so a recorded trace of readings can be fed
+// straight into it.
+class ambientFilter
+{
+public:
+    // reset starts the filter at reading, with the brightness right where
+    // the curve puts it.
+    void reset(uint16_t reading);
+    // add takes one 12 bit reading, and returns the brightness after it.
+    uint8_t add(uint16_t reading);
+
+    uint8_t brightness() const {return bright;}
+    uint8_t target() const;
+
+private:
+    // Smoothed reading, scaled up by 16 to keep the fraction.
+    uint32_t level;
+    uint8_t bright;
+    bool moving = false;
+};
+
+#ifdef ARDUINO
+// ambientBegin starts sampling the sensor on the given ADC1 channel.
+void ambientBegin(adc1_channel_t channel);
+
+// ambientBrightness is the brightness the sensor currently calls for.
+uint8_t ambientBrightness();
+#endif
@@ -0,0 +1,79 @@
+#include "animator.h"
+#include "hot.h"
+
+uint32_t frameMillis = 0;
+
+frameAnimator::frameAnimator(uint16_t count) :
+    anims(new animation[count]()),
+    count(count)
+{
+}
+
+frameAnimator::~frameAnimator()
+{
+    delete[] anims;
+}
+
+void frameAnimator::StartAnimation(uint16_t index, uint16_t duration,
+                                   AnimUpdateCallback fn)
+{
+    if (index >= count)
+        return;
+
+    auto& a = anims[index];
+    if (!a.active)
+        activeCount++;
+    a.start = frameMillis;
+    a.duration = duration ? duration : 1;
+    a.active = true;
+    a.started = false;
+    a.fn = fn;
+}
+
+uint32_t frameAnimator::Elapsed(uint16_t index) const
+{
+    return index < count ? frameMillis - anims[index].start : 0;
+}
+
+void frameAnimator::ResumeAnimation(uint16_t index, uint16_t duration,
+                                    uint32_t elapsed, AnimUpdateCallback fn)
+{
+    StartAnimation(index, duration, fn);
+    if (index >= count)
+        return;
+
+    anims[index].start = frameMillis - elapsed;
+    anims[index].started = elapsed > 0;
+}
+
+void frameAnimator::StopAll()
+{
+    for (uint16_t i = 0; i < count; i++)
+        anims[i].active = false;
+    activeCount = 0;
+}
+
+void LAMP_HOT frameAnimator::UpdateAnimations()
+{
+    for (uint16_t i = 0; i < count && activeCount > 0; i++) {
+        auto& a = anims[i];
+        if (!a.active)
+            continue;
+
+        uint32_t elapsed = frameMillis - a.start;
+        AnimationParam param;
+        param.index = i;
+        if (elapsed >= a.duration) {
+            param.progress = 1.0f;
+            param.state = AnimationState_Completed;
+            a.active = false;
+            activeCount--;
+        } else {
+            param.progress = float(elapsed) / float(a.duration);
+            param.state = a.started ? AnimationState_Progress
+                                    : AnimationState_Started;
+        }
+        a.started = true;
+        a.fn(param);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <NeoPixelAnimator.h>
+
+// The frame clock. Anything that animates takes the time from frameMillis
+// rather than millis(). The main loop sets it from millis() every frame, and
+// the offline renderer steps it as fast as frames can be drawn.
+extern uint32_t frameMillis;
+
+// frameAnimator does the same job as NeoPixelAnimator, with the same calls,
+// but runs off the frame clock.
+class frameAnimator
+{
+public:
+    frameAnimator(uint16_t count);
+    ~frameAnimator();
+
+    void StartAnimation(uint16_t index, uint16_t duration,
+                        AnimUpdateCallback fn);
+    void StopAll();
+    bool IsAnimating() const {return activeCount > 0;}
+    // UpdateAnimations calls each running animation's callback with its
+    // progress at the current frame time. An animation that has run its
+    // course gets a final call with progress 1.0 and stops.
+    void UpdateAnimations();
+
+    // Animations can be picked up again part way through: IsActive and
+    // Elapsed say where animation index has got to, and ResumeAnimation
+    // starts it over as if it had been running for elapsed ms already.
+    bool IsActive(uint16_t index) const
+    {
+        return index < count && anims[index].active;
+    }
+    uint32_t Elapsed(uint16_t index) const;
+    uint16_t Duration(uint16_t index) const
+    {
+        return index < count ? anims[index].duration : 0;
+    }
+    void ResumeAnimation(uint16_t index, uint16_t duration, uint32_t elapsed,
+                         AnimUpdateCallback fn);
+
+private:
+    struct animation
+    {
+        uint32_t start;
+        uint16_t duration;
+        bool active;
+        bool started;
+        AnimUpdateCallback fn;
+    };
+
+    animation* anims;
+    uint16_t count;
+    uint16_t activeCount = 0;
+};
@@ -0,0 +1,282 @@
+#include <Arduino.h>
+#include "bench.h"
+#include "calibration.h"
+#include "ddafade.h"
+#include "matrix.h"
+#include "life.h"
+#include "kernels.h"
+
+// Enough iterations that micros() resolution doesn't matter, without taking
+// long enough to trip the watchdog at the large sizes.
+static const int benchFrames = 200;
+
+// report prints the time per frame and per pixel for a pass.
+static void report(const char* name, size_t pixels, unsigned long elapsed)
+{
+    float perFrame = float(elapsed) / benchFrames;
+    Serial.printf("%-24s %7u px: %9.1f us/frame %7.1f ns/px\n", name,
+        unsigned(pixels), perFrame, perFrame * 1000.0f / pixels);
+}
+
+static void benchCalibration(size_t pixels)
+{
+    uint8_t* src = (uint8_t*)malloc(pixels * 4);
+    uint8_t* dst = (uint8_t*)malloc(pixels * 4);
+    uint8_t* gains = (uint8_t*)malloc(pixels * 4);
+    if (!src || !dst || !gains) {
+        Serial.printf("calibration %u px: out of memory\n", unsigned(pixels));
+        free(src);
+        free(dst);
+        free(gains);
+        return;
+    }
+
+    for (size_t i = 0; i < pixels * 4; i++) {
+        src[i] = i * 7;
+        gains[i] = 240 + i % 16;
+    }
+
+    // A plausible correction: pull a little of each color into its
+    // neighbours and trim the white.
+    const int16_t rgbw[4][4] = {
+        {3900, 150, 50, 0},
+        {100, 3950, 50, 0},
+        {50, 100, 4000, 0},
+        {0, 0, 0, 3800},
+    };
+    const uint8_t order[4] = {1, 0, 2, 3};
+
+    colorCalibration cal;
+    resetCalibration(cal, gains);
+    setCalibrationMatrix(cal, rgbw, order);
+
+    unsigned long start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        applyCalibration(cal, src, dst, pixels);
+    report("calibration matrix", pixels, micros() - start);
+
+    cal.hasGains = true;
+    start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        applyCalibration(cal, src, dst, pixels);
+    report("calibration + gains", pixels, micros() - start);
+
+    // Brightness alone is a table lookup.
+    colorCalibration dimmed;
+    resetCalibration(cal, gains);
+    scaleCalibration(cal, 128, dimmed);
+    start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        applyCalibration(dimmed, src, dst, pixels);
+    report("calibration brightness", pixels, micros() - start);
+
+    free(src);
+    free(dst);
+    free(gains);
+}
+
+// benchFades compares an independent 15s-ish fade on every pixel done with
+// ddaFade against the same fades done with LinearBlend, at 20ms frames.
+static void benchFades(size_t pixels)
+{
+    ddaFade* fades = (ddaFade*)malloc(pixels * sizeof(ddaFade));
+    RgbwColor* from = (RgbwColor*)malloc(pixels * sizeof(RgbwColor));
+    RgbwColor* to = (RgbwColor*)malloc(pixels * sizeof(RgbwColor));
+    uint16_t* durations = (uint16_t*)malloc(pixels * sizeof(uint16_t));
+    RgbwColor* out = (RgbwColor*)malloc(pixels * sizeof(RgbwColor));
+    if (!fades || !from || !to || !durations || !out) {
+        Serial.printf("fade %u px: out of memory\n", unsigned(pixels));
+        free(fades);
+        free(from);
+        free(to);
+        free(durations);
+        free(out);
+        return;
+    }
+
+    for (size_t i = 0; i < pixels; i++) {
+        from[i] = RgbwColor(i * 3, i * 5, i * 7, 0);
+        to[i] = RgbwColor(i * 11, 255 - i, i * 13, 40);
+        durations[i] = 14000 + i % 2000;
+        fades[i].start(from[i], to[i], 0, durations[i]);
+    }
+
+    uint32_t now = 0;
+    unsigned long start = micros();
+    for (int f = 0; f < benchFrames; f++) {
+        now += 20;
+        for (size_t i = 0; i < pixels; i++)
+            if (fades[i].update(now))
+                out[i] = fades[i].color();
+    }
+    report("fade ddaFade", pixels, micros() - start);
+
+    now = 0;
+    start = micros();
+    for (int f = 0; f < benchFrames; f++) {
+        now += 20;
+        for (size_t i = 0; i < pixels; i++) {
+            float progress = float(now) / durations[i];
+            out[i] = RgbwColor::LinearBlend(from[i], to[i], progress);
+        }
+    }
+    report("fade LinearBlend", pixels, micros() - start);
+
+    free(fades);
+    free(from);
+    free(to);
+    free(durations);
+    free(out);
+}
+
+// benchMatrix times full screen fills, blits and text on a width x height
+// serpentine panel.
+static void benchMatrix(uint16_t width, uint16_t height)
+{
+    const size_t pixels = size_t(width) * height;
+    uint8_t* buffer = (uint8_t*)malloc(pixels * 4);
+    uint8_t* image = (uint8_t*)malloc(pixels);
+    if (!buffer || !image) {
+        Serial.printf("matrix %u px: out of memory\n", unsigned(pixels));
+        free(buffer);
+        free(image);
+        return;
+    }
+
+    RgbwColor palette[16];
+    for (int i = 0; i < 16; i++)
+        palette[i] = RgbwColor(i * 16, 255 - i * 16, i * 8, i & 3);
+    for (size_t i = 0; i < pixels; i++)
+        image[i] = (i * 7 + i / width) & 15;
+
+    const uint8_t order[4] = {1, 0, 2, 3};
+    matrix m(buffer, 0, width, height, matrixSerpentine, order);
+    sprite full = {width, height, image, palette, 16, -1};
+    sprite keyed = {width, height, image, palette, 16, 0};
+
+    unsigned long start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        m.clear(RgbwColor(f, 0, 0, 0));
+    report("matrix fill", pixels, micros() - start);
+
+    start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        m.blit(full, 0, 0);
+    report("matrix blit", pixels, micros() - start);
+
+    start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        m.blit(keyed, 0, 0, 128);
+    report("matrix blit keyed alpha", pixels, micros() - start);
+
+    // Half off the top left corner, so every row is clipped.
+    start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        m.blit(full, -width / 2, -height / 2);
+    report("matrix blit clipped", pixels / 4, micros() - start);
+
+    char line[32];
+    for (int i = 0; i < 31; i++)
+        line[i] = '0' + i % 10;
+    line[31] = 0;
+    start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        for (int y = 0; y < height; y += smallDigits.height + 1)
+            m.text(smallDigits, 0, y, line, RgbwColor(255));
+    report("matrix text", pixels, micros() - start);
+
+    free(buffer);
+    free(image);
+}
+
+// benchLife times generations of a width x height Game of Life.
+static void benchLife(uint16_t width, uint16_t height)
+{
+    life grid(width, height);
+    grid.seed(64);
+
+    unsigned long start = micros();
+    for (int f = 0; f < benchFrames; f++)
+        grid.step();
+    report("life generation", size_t(width) * height, micros() - start);
+}
+
+// benchKernels times every kernel set this CPU can run over pixels RGBW
+// pixels. On the ESP32 that's only the scalar set; test/kernels_bench.cpp
+// times the x86 sets, and sizes well past what fits here.
+static void benchKernels(size_t pixels)
+{
+    const size_t n = pixels * 4;
+    uint8_t* a = (uint8_t*)malloc(n);
+    uint8_t* b = (uint8_t*)malloc(n);
+    uint8_t* dst = (uint8_t*)malloc(n);
+    uint16_t* wide = (uint16_t*)malloc(n * sizeof(uint16_t));
+    if (!a || !b || !dst || !wide) {
+        Serial.printf("kernels %u px: out of memory\n", unsigned(pixels));
+        free(a);
+        free(b);
+        free(dst);
+        free(wide);
+        return;
+    }
+
+    uint8_t table[256];
+    for (int i = 0; i < 256; i++)
+        table[i] = i * i / 255;
+    for (size_t i = 0; i < n; i++) {
+        a[i] = i * 7;
+        b[i] = i * 13;
+        wide[i] = i * 1031;
+    }
+
+    const pixelKernels* variants[4];
+    size_t count = kernelVariants(variants, 4);
+    for (size_t v = 0; v < count; v++) {
+        const pixelKernels& k = *variants[v];
+        char name[32];
+
+        unsigned long start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.blend(dst, a, b, n, f);
+        snprintf(name, sizeof(name), "blend %s", k.name);
+        report(name, pixels, micros() - start);
+
+        start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.composite(dst, b, n, f);
+        snprintf(name, sizeof(name), "composite %s", k.name);
+        report(name, pixels, micros() - start);
+
+        start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.gamma(dst, a, n, table);
+        snprintf(name, sizeof(name), "gamma %s", k.name);
+        report(name, pixels, micros() - start);
+
+        start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.dither(dst, wide, n, f);
+        snprintf(name, sizeof(name), "dither %s", k.name);
+        report(name, pixels, micros() - start);
+    }
+
+    free(a);
+    free(b);
+    free(dst);
+    free(wide);
+}
+
+void runBenchmarks()
+{
+    Serial.println("Benchmarks:");
+    benchCalibration(24);
+    benchCalibration(5000);
+    benchFades(24);
+    benchFades(5000);
+    benchMatrix(64, 64);
+    benchLife(16, 16);
+    benchLife(256, 256);
+    benchKernels(1000);
+    benchKernels(5000);
+    Serial.flush();
+}
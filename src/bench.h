@@ -0,0 +1,6 @@
+#pragma once
+
+// runBenchmarks times the per-frame passes at a few pixel counts and prints
+// the results over Serial. It's only called when built with -DBENCHMARK
+// (pio run -e bench).
+void runBenchmarks();
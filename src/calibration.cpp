@@ -0,0 +1,137 @@
+#include <Preferences.h>
+#include "calibration.h"
+#include "kernels.h"
+#include "hot.h"
+
+// NVS namespace and keys the calibration lives under.
+static const char* calibrationSpace = "calib";
+static const char* matrixKey = "matrix";
+static const char* gainsKey = "gains";
+
+// updateUniform works out whether cal is a single gain on the diagonal, and
+// if so fills in the table that applies it, rounding and clamping exactly as
+// the matrix pass would.
+static void updateUniform(colorCalibration& cal)
+{
+    const int32_t gain = cal.matrix[0][0];
+    cal.uniform = !cal.hasGains;
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            if (cal.matrix[row][col] != (row == col ? gain : 0))
+                cal.uniform = false;
+    if (!cal.uniform)
+        return;
+
+    for (int32_t in = 0; in < 256; in++) {
+        int32_t v = (gain * in + CalibrationOne / 2) >> 12;
+        cal.table[in] = v < 0 ? 0 : (v > 255 ? 255 : v);
+    }
+}
+
+static void updateIdentity(colorCalibration& cal)
+{
+    cal.identity = !cal.hasGains;
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            if (cal.matrix[row][col] != (row == col ? CalibrationOne : 0))
+                cal.identity = false;
+    updateUniform(cal);
+}
+
+void resetCalibration(colorCalibration& cal, uint8_t* gains)
+{
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            cal.matrix[row][col] = row == col ? CalibrationOne : 0;
+    cal.gains = gains;
+    cal.hasGains = false;
+    updateIdentity(cal);
+}
+
+void setCalibrationMatrix(colorCalibration& cal, const int16_t rgbw[4][4],
+                          const uint8_t order[4])
+{
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            cal.matrix[row][col] = rgbw[order[row]][order[col]];
+    updateIdentity(cal);
+}
+
+void loadCalibration(colorCalibration& cal, const uint8_t order[4],
+                     size_t pixelCount)
+{
+    Preferences prefs;
+    if (!prefs.begin(calibrationSpace, true))
+        return;
+
+    int16_t rgbw[4][4];
+    if (prefs.getBytes(matrixKey, rgbw, sizeof(rgbw)) == sizeof(rgbw))
+        setCalibrationMatrix(cal, rgbw, order);
+
+    if (cal.gains != nullptr)
+        cal.hasGains = prefs.getBytes(gainsKey, cal.gains, pixelCount * 4) ==
+                       pixelCount * 4;
+
+    prefs.end();
+    updateIdentity(cal);
+}
+
+void saveCalibration(const int16_t rgbw[4][4], const uint8_t* gains,
+                     size_t pixelCount)
+{
+    Preferences prefs;
+    if (!prefs.begin(calibrationSpace, false))
+        return;
+
+    prefs.putBytes(matrixKey, rgbw, 4 * 4 * sizeof(int16_t));
+    if (gains != nullptr)
+        prefs.putBytes(gainsKey, gains, pixelCount * 4);
+    else
+        prefs.remove(gainsKey);
+
+    prefs.end();
+}
+
+void scaleCalibration(const colorCalibration& cal, uint8_t level,
+                      colorCalibration& out)
+{
+    out = cal;
+    if (level == 255)
+        return;
+
+    for (int row = 0; row < 4; row++)
+        for (int col = 0; col < 4; col++)
+            out.matrix[row][col] = int32_t(cal.matrix[row][col]) * level / 255;
+    out.identity = false;
+    updateUniform(out);
+}
+
+// The pass is written as straight-line integer math over a fixed 4x4 so the
+// compiler can unroll it, and vectorize it on targets that have the
+// instructions for it.
+void LAMP_HOT applyCalibration(const colorCalibration& cal,
+                               const uint8_t* src, uint8_t* dst,
+                               size_t pixelCount)
+{
+    if (cal.uniform) {
+        bestKernels().gamma(dst, src, pixelCount * 4, cal.table);
+        return;
+    }
+
+    const int16_t (&m)[4][4] = cal.matrix;
+    const uint8_t* gains = cal.hasGains ? cal.gains : nullptr;
+
+    for (size_t i = 0; i < pixelCount * 4; i += 4) {
+        const int32_t in0 = src[i], in1 = src[i + 1];
+        const int32_t in2 = src[i + 2], in3 = src[i + 3];
+
+        for (int row = 0; row < 4; row++) {
+            int32_t v = m[row][0] * in0 + m[row][1] * in1 +
+                        m[row][2] * in2 + m[row][3] * in3;
+            v = (v + CalibrationOne / 2) >> 12;
+            if (gains)
+                v = (v * (gains[i + row] + 1)) >> 8;
+            dst[i + row] = v < 0 ? 0 : (v > 255 ? 255 : v);
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Color calibration for the output stage.
+//
+// LEDs from different bins don't produce quite the same color for the same
+// RgbwColor. Each fixture can carry a 4x4 matrix that maps the color a mode
+// asked for onto the channel values that produce it on this fixture's LEDs,
+// and optionally a gain for every channel of every pixel on top of that.
+//
+// The matrix is fixed point, with CalibrationOne meaning 1.0, and is kept in
+// the order the channels go out on the wire so the pass never has to
+// shuffle bytes.
+
+const int16_t CalibrationOne = 1 << 12;
+
+struct colorCalibration
+{
+    // out[row] = sum(matrix[row][col] * in[col]), in wire order.
+    int16_t matrix[4][4];
+    // Per-pixel, per-channel gain in wire order. A gain g scales by
+    // (g + 1) / 256, so 255 leaves the channel alone. gains is storage the
+    // caller provides (it may be null), and hasGains says whether any were
+    // loaded into it.
+    uint8_t* gains;
+    bool hasGains;
+    // Set when the matrix is the identity and there are no gains, so the
+    // output stage can skip the pass entirely.
+    bool identity;
+    // Set when the matrix only scales every channel the same, as plain
+    // brightness does, and there are no gains. The pass is then a lookup in
+    // table, done with the fastest pixel kernels there are.
+    bool uniform;
+    uint8_t table[256];
+};
+
+// resetCalibration sets cal to the identity. gains is where loadCalibration
+// will put per-pixel gains, and may be null if this fixture doesn't use them.
+void resetCalibration(colorCalibration& cal, uint8_t* gains);
+
+// setCalibrationMatrix takes a matrix in R, G, B, W order and stores it in
+// wire order. order[i] is the RGBW channel that goes out in byte i.
+void setCalibrationMatrix(colorCalibration& cal, const int16_t rgbw[4][4],
+                          const uint8_t order[4]);
+
+// loadCalibration reads this fixture's calibration from NVS, leaving the
+// identity in place for anything that isn't stored. pixelCount is the size
+// of cal.gains in pixels.
+void loadCalibration(colorCalibration& cal, const uint8_t order[4],
+                     size_t pixelCount);
+
+// saveCalibration writes a matrix in RGBW order, and optionally per-pixel
+// gains in wire order, to NVS for loadCalibration to find after a reboot.
+void saveCalibration(const int16_t rgbw[4][4], const uint8_t* gains,
+                     size_t pixelCount);
+
+// scaleCalibration makes out a copy of cal that also dims everything to
+// level/255, so brightness costs nothing extra in the output pass.
+void scaleCalibration(const colorCalibration& cal, uint8_t level,
+                      colorCalibration& out);
+
+// applyCalibration writes the corrected pixels in src to dst. Both are raw
+// pixel buffers of pixelCount pixels, 4 bytes each.
+void applyCalibration(const colorCalibration& cal, const uint8_t* src,
+                      uint8_t* dst, size_t pixelCount);
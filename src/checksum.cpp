@@ -0,0 +1,97 @@
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <rom/crc.h>
+#else
+#include <chrono>
+#endif
+#include "checksum.h"
+#include "hot.h"
+
+#ifdef ARDUINO
+
+// The ROM has a table driven CRC-32 that costs no flash and never misses
+// the cache.
+uint32_t LAMP_HOT frameCrc(uint32_t crc, const uint8_t* data, size_t len)
+{
+    return crc32_le(crc, data, len);
+}
+#else
+uint32_t frameCrc(uint32_t crc, const uint8_t* data, size_t len)
+{
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+#endif
+
+// clockUs is what the cost is measured with.
+static uint32_t clockUs()
+{
+#ifdef ARDUINO
+    return micros();
+#else
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static bool enabled;
+// The second being added up, and what's been added to it so far.
+static uint32_t second;
+static uint32_t secondCrc;
+static uint32_t secondFrames;
+// Time spent on checksums this second, in us.
+static uint32_t spent;
+
+void checksumEnable(bool on)
+{
+    enabled = on;
+    secondFrames = 0;
+}
+
+bool checksumEnabled()
+{
+    return enabled;
+}
+
+void LAMP_HOT checksumFrame(uint32_t ms, const uint8_t* pixels, size_t len,
+                            Print& out)
+{
+    if (!enabled)
+        return;
+
+    if (ms / 1000 != second)
+        checksumFlush(out);
+    if (!secondFrames) {
+        second = ms / 1000;
+        secondCrc = 0;
+        spent = 0;
+    }
+
+    uint32_t start = clockUs();
+    secondCrc = frameCrc(secondCrc, pixels, len);
+    spent += clockUs() - start;
+    secondFrames++;
+}
+
+void checksumFlush(Print& out)
+{
+    if (!secondFrames)
+        return;
+    // spent is us out of 1000000, so this is the cost in percent.
+    out.printf("crc %u %u %08x %.3f%%\n", unsigned(second),
+        unsigned(secondFrames), unsigned(secondCrc), spent / 10000.0f);
+    secondFrames = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <Print.h>
+
+// Frame checksums, for checking that the lamp draws exactly what a host
+// build of the same code does.
+//
+// With checksums on, every frame is run through CRC-32 just before it goes
+// out, and the CRCs are chained together for each second of frame time.
+// When a second is over, a line
+//   crc <second> <frames> <crc> <cost>
+// goes out on Serial, where crc is the CRC-32 of all that second's frames
+// back to back (zlib.crc32 of them in Python) and cost is the share of the
+// second spent working it out.
+//
+// The live lamp's clock is millis(), so no two runs line up. For comparing
+// the lamp with a host build, an offline render with checksums on sends
+// these lines in place of its frames, on the render's fixed clock. Its CRCs
+// are of the frames as they would go out, after calibration and brightness,
+// the same as the live lamp's, though the frames it sends with checksums
+// off are as the mode drew them. The host lamp in test/ (make -C test lamp)
+// takes the same commands:
+//   test/build/lamp c 'r 2 60 20 1 7 0'
+// The two have to print the same CRCs; where they don't, something came out
+// differently on the Xtensa, floating point most likely.
+
+// frameCrc continues crc over len more bytes. Start from 0.
+uint32_t frameCrc(uint32_t crc, const uint8_t* data, size_t len);
+
+void checksumEnable(bool on);
+bool checksumEnabled();
+
+// checksumFrame adds a frame drawn at frame time ms.
+void checksumFrame(uint32_t ms, const uint8_t* pixels, size_t len,
+                   Print& out);
+// checksumFlush prints the line for the second so far, without waiting for
+// it to end.
+void checksumFlush(Print& out);
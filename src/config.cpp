@@ -0,0 +1,226 @@
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "whitetable.h"
+
+enum fieldType
+{
+    fieldU8,
+    fieldU16,
+    fieldFloat,
+};
+
+struct configField
+{
+    const char* name;
+    fieldType type;
+    size_t offset;
+    // The values the field can take. A config with any field outside its
+    // range is refused as a whole.
+    float min;
+    float max;
+};
+
+static const configField fields[] = {
+    {"fadeDelay", fieldU16, offsetof(lampConfig, fadeDelay), 1, 65535},
+    {"rotateDelay", fieldU16, offsetof(lampConfig, rotateDelay), 1, 65535},
+    {"switchColsDelay", fieldU16, offsetof(lampConfig, switchColsDelay),
+     1, 65535},
+    {"saturation", fieldU8, offsetof(lampConfig, saturation), 0, 255},
+    {"luminance", fieldFloat, offsetof(lampConfig, luminance), 0, 1},
+    // Up to pixelLimit, below.
+    {"pixelCount", fieldU16, offsetof(lampConfig, pixelCount), 1, 65535},
+    {"maxBrightness", fieldU8, offsetof(lampConfig, maxBrightness), 0, 255},
+    {"kelvin", fieldU16, offsetof(lampConfig, kelvin),
+     WhiteMinKelvin, WhiteMaxKelvin},
+    {"fadeWander", fieldU8, offsetof(lampConfig, fadeWander), 0, 100},
+    {"rotateSwing", fieldU8, offsetof(lampConfig, rotateSwing), 0, 100},
+    {"swingPeriod", fieldU16, offsetof(lampConfig, swingPeriod), 1, 65535},
+    {"encoderSpeed", fieldU8, offsetof(lampConfig, encoderSpeed), 0, 1},
+};
+
+static uint16_t pixelLimit = 65535;
+
+void configPixelLimit(uint16_t pixels)
+{
+    pixelLimit = pixels;
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void configParser::begin(const lampConfig& base)
+{
+    staged = base;
+    state = expectObject;
+    err = nullptr;
+}
+
+configStatus configParser::fail(const char* why)
+{
+    state = failed;
+    err = why;
+    return configError;
+}
+
+// store puts the number just parsed into the field named by key.
+bool configParser::store()
+{
+    for (const auto& f : fields) {
+        if (strcmp(f.name, key) != 0)
+            continue;
+
+        if (f.type != fieldFloat && (negative || decimals > 0)) {
+            err = "expected a whole number";
+            return false;
+        }
+        float v = float(mantissa);
+        for (int8_t d = 0; d < decimals; d++)
+            v /= 10.0f;
+        if (negative)
+            v = -v;
+        float max = f.offset == offsetof(lampConfig, pixelCount) ?
+                    pixelLimit : f.max;
+        if (v < f.min || v > max) {
+            err = "value out of range";
+            return false;
+        }
+
+        uint8_t* p = reinterpret_cast<uint8_t*>(&staged) + f.offset;
+        if (f.type == fieldFloat)
+            *reinterpret_cast<float*>(p) = v;
+        else if (f.type == fieldU8)
+            *p = mantissa;
+        else
+            *reinterpret_cast<uint16_t*>(p) = mantissa;
+        return true;
+    }
+
+    err = "unknown key";
+    return false;
+}
+
+configStatus configParser::feed(char c)
+{
+    switch (state) {
+    case expectObject:
+        if (isSpace(c))
+            return configMore;
+        if (c != '{')
+            return fail("expected {");
+        state = expectKey;
+        return configMore;
+
+    case expectKey:
+        if (isSpace(c))
+            return configMore;
+        if (c == '}') {
+            state = done;
+            return configDone;
+        }
+        if (c != '"')
+            return fail("expected a key");
+        keyLen = 0;
+        state = inKey;
+        return configMore;
+
+    case inKey:
+        if (c == '"') {
+            key[keyLen] = 0;
+            state = expectColon;
+            return configMore;
+        }
+        if (keyLen >= sizeof(key) - 1)
+            return fail("unknown key");
+        key[keyLen++] = c;
+        return configMore;
+
+    case expectColon:
+        if (isSpace(c))
+            return configMore;
+        if (c != ':')
+            return fail("expected :");
+        state = expectValue;
+        return configMore;
+
+    case expectValue:
+        if (isSpace(c))
+            return configMore;
+        mantissa = 0;
+        decimals = 0;
+        negative = false;
+        seenPoint = false;
+        seenDigit = false;
+        state = inValue;
+        if (c == '-') {
+            negative = true;
+            return configMore;
+        }
+        // c is the first character of the number.
+        // fall through
+
+    case inValue:
+        if (c >= '0' && c <= '9') {
+            // Digits of a fraction past what a float can use are dropped,
+            // but a whole number that long is too big for any field.
+            if (mantissa < 100000000) {
+                mantissa = mantissa * 10 + (c - '0');
+                if (seenPoint)
+                    decimals++;
+            } else if (!seenPoint) {
+                return fail("number too long");
+            }
+            seenDigit = true;
+            return configMore;
+        }
+        if (c == '.' && !seenPoint) {
+            seenPoint = true;
+            return configMore;
+        }
+        if (!seenDigit)
+            return fail("expected a number");
+        if (!store())
+            return fail(err);
+        // c ended the number, and may be a , or }.
+        state = afterValue;
+        // fall through
+
+    case afterValue:
+        if (isSpace(c))
+            return configMore;
+        if (c == ',') {
+            state = expectKey;
+            return configMore;
+        }
+        if (c == '}') {
+            state = done;
+            return configDone;
+        }
+        return fail("expected , or }");
+
+    case done:
+        return configDone;
+
+    case failed:
+    default:
+        return configError;
+    }
+}
+
+size_t formatConfig(const lampConfig& cfg, char* buf, size_t len)
+{
+    int n = snprintf(buf, len,
+        "{\"fadeDelay\":%u,\"rotateDelay\":%u,\"switchColsDelay\":%u,"
+        "\"saturation\":%u,\"luminance\":%.3f,\"pixelCount\":%u,"
+        "\"maxBrightness\":%u,\"kelvin\":%u,\"fadeWander\":%u,"
+        "\"rotateSwing\":%u,\"swingPeriod\":%u,\"encoderSpeed\":%u}",
+        unsigned(cfg.fadeDelay), unsigned(cfg.rotateDelay),
+        unsigned(cfg.switchColsDelay), unsigned(cfg.saturation),
+        double(cfg.luminance), unsigned(cfg.pixelCount),
+        unsigned(cfg.maxBrightness), unsigned(cfg.kelvin),
+        unsigned(cfg.fadeWander), unsigned(cfg.rotateSwing),
+        unsigned(cfg.swingPeriod), unsigned(cfg.encoderSpeed));
+    return n < 0 ? 0 : (size_t(n) < len ? n : len - 1);
+}
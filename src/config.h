@@ -0,0 +1,100 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// The lamp's tunable settings. These used to be constants; now they can be
+// changed over Serial, or saved to flash and loaded at boot, without a
+// rebuild.
+//
+// Config is written as a flat JSON object of numbers, for example
+//   {"fadeDelay": 8000, "luminance": 0.3, "maxBrightness": 180}
+// and any field left out keeps its current value. Each field has a range,
+// in config.cpp, and a config with a value outside it is refused.
+struct lampConfig
+{
+    // ms modeFader takes to fade from one color to the next.
+    uint16_t fadeDelay;
+    // ms modeRotator waits before moving to the next pixel.
+    uint16_t rotateDelay;
+    // ms modeRotator takes to swap its two colors for new ones.
+    uint16_t switchColsDelay;
+    uint8_t saturation;
+    float luminance;
+    // Pixels actually fitted, up to PixelCount.
+    uint16_t pixelCount;
+    // The output never goes brighter than this, whatever else asks for.
+    uint8_t maxBrightness;
+    // Color temperature for modeLight.
+    uint16_t kelvin;
+    // How far, in percent, a slow random walk pushes modeFader's fadeDelay
+    // and modeRotator's switchColsDelay about. 0 leaves them steady.
+    uint8_t fadeWander;
+    // How far, in percent, modeRotator's rotateDelay swings, and how long a
+    // swing takes in ms.
+    uint8_t rotateSwing;
+    uint16_t swingPeriod;
+    // 1 to have the rotary encoder change the speed of the modes rather
+    // than the brightness.
+    uint8_t encoderSpeed;
+};
+
+enum configStatus
+{
+    configMore,
+    configDone,
+    configError,
+};
+
+// configParser parses config one character at a time, so it can be fed
+// straight from Serial or from flash, and it never allocates. Fields are
+// parsed into a copy of the config it was started from, which only becomes
+// the result once the whole object has parsed, so a bad line never leaves a
+// config half applied.
+class configParser
+{
+public:
+    void begin(const lampConfig& base);
+    configStatus feed(char c);
+
+    const lampConfig& result() const {return staged;}
+    // error describes what went wrong after feed() returns configError.
+    const char* error() const {return err;}
+
+private:
+    enum parseState
+    {
+        expectObject,
+        expectKey,
+        inKey,
+        expectColon,
+        expectValue,
+        inValue,
+        afterValue,
+        done,
+        failed,
+    };
+
+    configStatus fail(const char* why);
+    bool store();
+
+    lampConfig staged;
+    parseState state;
+    const char* err;
+
+    char key[24];
+    uint8_t keyLen;
+    // The number being parsed, as digits and a count of digits after the
+    // decimal point.
+    int64_t mantissa;
+    int8_t decimals;
+    bool negative;
+    bool seenPoint;
+    bool seenDigit;
+};
+
+// configPixelLimit sets the most pixels a config can ask for, which is as
+// many as the build has room for.
+void configPixelLimit(uint16_t pixels);
+
+// formatConfig writes cfg as JSON into buf, and returns the length.
+size_t formatConfig(const lampConfig& cfg, char* buf, size_t len);
@@ -0,0 +1,58 @@
+#include "ddafade.h"
+#include "hot.h"
+
+void ddaFade::start(const RgbwColor& from, const RgbwColor& to, uint32_t now,
+                    uint16_t duration)
+{
+    const uint8_t a[4] = {from.R, from.G, from.B, from.W};
+    const uint8_t b[4] = {to.R, to.G, to.B, to.W};
+
+    for (int i = 0; i < 4; i++) {
+        auto& c = ch[i];
+        c.value = a[i];
+        c.dir = b[i] > a[i] ? 1 : -1;
+        c.steps = b[i] > a[i] ? b[i] - a[i] : a[i] - b[i];
+        c.remaining = c.steps;
+        if (c.steps == 0)
+            continue;
+
+        // Step k falls due at now + k * duration / steps, rounded up, which
+        // puts the channel where a linear blend would truncate to. acc keeps
+        // the fraction of a ms, k * rem modulo steps.
+        c.interval = duration / c.steps;
+        c.rem = duration % c.steps;
+        c.acc = c.rem;
+        c.next = now + c.interval + (c.acc != 0);
+    }
+}
+
+void ddaFade::rebase(uint32_t from, uint32_t to)
+{
+    for (auto& c : ch)
+        c.next += to - from;
+}
+
+bool LAMP_HOT ddaFade::update(uint32_t now)
+{
+    bool changed = false;
+
+    for (auto& c : ch) {
+        while (c.remaining && int32_t(now - c.next) >= 0) {
+            c.value += c.dir;
+            c.remaining--;
+            changed = true;
+
+            // Carry when acc + rem >= steps, written so acc can't overflow,
+            // and move the round up from the old fraction to the new one.
+            c.next += c.interval - (c.acc != 0);
+            if (c.acc >= c.steps - c.rem) {
+                c.acc -= c.steps - c.rem;
+                c.next++;
+            } else {
+                c.acc += c.rem;
+            }
+            c.next += c.acc != 0;
+        }
+    }
+    return changed;
+}
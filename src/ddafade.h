@@ -0,0 +1,58 @@
+#pragma once
+#include <NeoPixelBus.h>
+
+// ddaFade fades a color to a target over a fixed time without blending.
+//
+// Fading one channel from a to b over D ms is just |b - a| steps of +-1, and
+// the time of every step is known up front. Like Bresenham's line algorithm,
+// ddaFade works out the whole and fractional ms between steps once, in
+// start(), and from then on each update is an add and a compare per channel.
+// Channels that aren't due to change cost a single compare, and update() says
+// whether anything changed, so callers can skip redrawing when nothing did.
+//
+// Each ddaFade is 48 bytes, small enough to give every pixel its own.
+class ddaFade
+{
+public:
+    // start begins fading from 'from' to 'to', starting at frame time now and
+    // taking duration ms.
+    void start(const RgbwColor& from, const RgbwColor& to, uint32_t now,
+               uint16_t duration);
+
+    // update brings the color up to frame time now. It returns true if any
+    // channel changed.
+    bool update(uint32_t now);
+
+    // rebase moves the fade from one frame clock to another, so it carries
+    // on at frame time to from where it was at frame time from.
+    void rebase(uint32_t from, uint32_t to);
+
+    bool done() const
+    {
+        return !(ch[0].remaining | ch[1].remaining |
+                 ch[2].remaining | ch[3].remaining);
+    }
+
+    RgbwColor color() const
+    {
+        return RgbwColor(ch[0].value, ch[1].value, ch[2].value, ch[3].value);
+    }
+
+private:
+    struct channel
+    {
+        // Frame time the next step is due.
+        uint32_t next;
+        // Whole ms between steps, and the leftover fraction of a ms per step
+        // in 1/steps units.
+        uint16_t interval;
+        uint8_t rem;
+        uint8_t acc;
+        uint8_t steps;
+        uint8_t remaining;
+        uint8_t value;
+        int8_t dir;
+    };
+
+    channel ch[4];
+};
@@ -0,0 +1,104 @@
+#include "encoder.h"
+
+// The counter goes back to zero when it reaches either limit, which
+// encoderTake() allows for. Multiples of the counts per detent keep the
+// detents lined up across the wrap.
+static const int16_t CounterLimit = 32000;
+
+// Counts read but not yet a whole detent.
+static int32_t pending;
+static int16_t lastCount;
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <driver/pcnt.h>
+
+static const pcnt_unit_t Unit = PCNT_UNIT_0;
+// Ignore pulses shorter than this many 80MHz APB clocks, about 12us. That's
+// the longest the filter goes, and still far quicker than anyone turns a
+// knob.
+static const uint16_t GlitchFilter = 1023;
+
+void encoderBegin(uint8_t pinA, uint8_t pinB)
+{
+    pinMode(pinA, INPUT_PULLUP);
+    pinMode(pinB, INPUT_PULLUP);
+
+    // Channel 0 counts edges on A, channel 1 edges on B, each in the
+    // direction the other pin's level says, which is full quadrature.
+    pcnt_config_t c = {};
+    c.unit = Unit;
+    c.channel = PCNT_CHANNEL_0;
+    c.pulse_gpio_num = pinA;
+    c.ctrl_gpio_num = pinB;
+    c.pos_mode = PCNT_COUNT_DEC;
+    c.neg_mode = PCNT_COUNT_INC;
+    c.lctrl_mode = PCNT_MODE_REVERSE;
+    c.hctrl_mode = PCNT_MODE_KEEP;
+    c.counter_h_lim = CounterLimit;
+    c.counter_l_lim = -CounterLimit;
+    pcnt_unit_config(&c);
+
+    c.channel = PCNT_CHANNEL_1;
+    c.pulse_gpio_num = pinB;
+    c.ctrl_gpio_num = pinA;
+    c.pos_mode = PCNT_COUNT_INC;
+    c.neg_mode = PCNT_COUNT_DEC;
+    pcnt_unit_config(&c);
+
+    pcnt_set_filter_value(Unit, GlitchFilter);
+    pcnt_filter_enable(Unit);
+    pcnt_counter_pause(Unit);
+    pcnt_counter_clear(Unit);
+    pcnt_counter_resume(Unit);
+}
+
+static int16_t readCounter()
+{
+    int16_t count = 0;
+    pcnt_get_counter_value(Unit, &count);
+    return count;
+}
+#else
+static int16_t standIn;
+
+void encoderBegin(uint8_t, uint8_t)
+{
+    standIn = 0;
+}
+
+void encoderTurn(int16_t counts)
+{
+    int32_t count = standIn + counts;
+    // Wrap the way the hardware does.
+    while (count >= CounterLimit)
+        count -= CounterLimit;
+    while (count <= -CounterLimit)
+        count += CounterLimit;
+    standIn = count;
+}
+
+static int16_t readCounter()
+{
+    return standIn;
+}
+#endif
+
+int16_t encoderTake()
+{
+    int16_t count = readCounter();
+    int32_t delta = int32_t(count) - lastCount;
+    lastCount = count;
+
+    // A jump of more than half the range is the counter wrapping at a
+    // limit; nobody turns a knob that fast between frames.
+    if (delta > CounterLimit / 2)
+        delta -= CounterLimit;
+    else if (delta < -CounterLimit / 2)
+        delta += CounterLimit;
+
+    pending += delta;
+    int16_t detents = pending / EncoderCountsPerDetent;
+    pending -= detents * EncoderCountsPerDetent;
+    return detents;
+}
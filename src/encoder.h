@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+// A rotary encoder, decoded by the ESP32's pulse counter.
+//
+// The PCNT peripheral counts every edge on both of the encoder's pins, up or
+// down depending on the level of the other one, through its glitch filter, so
+// turning the knob costs no CPU and no interrupts at all. The render loop
+// just reads the count once a frame.
+//
+// Host builds get a stand-in counter instead, driven by encoderTurn().
+
+// Edges per detent on the usual encoders.
+const uint8_t EncoderCountsPerDetent = 4;
+
+void encoderBegin(uint8_t pinA, uint8_t pinB);
+
+// encoderTake returns how many detents the knob has turned since last time,
+// positive clockwise. Part turns are kept for next time.
+int16_t encoderTake();
+
+#ifndef ARDUINO
+// encoderTurn moves the stand-in counter by counts edges.
+void encoderTurn(int16_t counts);
+#endif
@@ -0,0 +1,165 @@
+#include <esp_attr.h>
+#include "energy.h"
+#include "hot.h"
+
+static const uint32_t energyMagic = 0x454e5231; // "ENR1"
+
+// Charge is kept in mA.ms and time in ms, 64 bits wide so neither overflows.
+struct energyStore
+{
+    uint32_t magic;
+    uint64_t modeCharge[EnergyMaxModes];
+    uint64_t modeTime[EnergyMaxModes];
+    uint64_t hourCharge[EnergyHours];
+    // Running time in ms over all boots, which picks the hour bucket.
+    uint64_t uptime;
+};
+
+static RTC_DATA_ATTR energyStore store;
+
+// Current of the frame that's out now, and when accounting last caught up.
+static uint32_t currentMa;
+static uint32_t lastMs;
+static uint8_t mode;
+
+// The last frame accounted for, a word per pixel, and what each of its
+// pixels draws in mA/255, along with the total. A frame only has the pixels
+// that changed worked out again.
+static uint32_t* shown;
+static uint16_t* pixelMa;
+static size_t tracked;
+static size_t counted;
+static uint32_t totalMa;
+
+uint16_t estimateMilliamps(const RgbwColor& col)
+{
+    return milliampsIdle + (col.R * milliampsR + col.G * milliampsG +
+                            col.B * milliampsB + col.W * milliampsW) / 255;
+}
+
+// catchUp charges the time since the last update to the current mode and
+// hour.
+static void catchUp(uint32_t ms)
+{
+    uint32_t elapsed = ms - lastMs;
+    lastMs = ms;
+
+    while (elapsed > 0) {
+        // Split the interval at hour boundaries.
+        const uint64_t hourMs = 3600000;
+        uint64_t intoHour = store.uptime % hourMs;
+        uint32_t chunk = elapsed;
+        if (intoHour + chunk > hourMs)
+            chunk = hourMs - intoHour;
+
+        uint64_t charge = uint64_t(currentMa) * chunk;
+        store.modeCharge[mode] += charge;
+        store.modeTime[mode] += chunk;
+        store.hourCharge[(store.uptime / hourMs) % EnergyHours] += charge;
+
+        // Starting a new hour, so its bucket from a day ago goes.
+        store.uptime += chunk;
+        if (store.uptime % hourMs == 0)
+            store.hourCharge[(store.uptime / hourMs) % EnergyHours] = 0;
+
+        elapsed -= chunk;
+    }
+}
+
+void energyBegin(uint32_t ms, size_t pixelCount)
+{
+    if (store.magic != energyMagic) {
+        memset(&store, 0, sizeof(store));
+        store.magic = energyMagic;
+    }
+    lastMs = ms;
+    currentMa = 0;
+    mode = 0;
+
+    free(shown);
+    free(pixelMa);
+    shown = (uint32_t*)calloc(pixelCount, sizeof(uint32_t));
+    pixelMa = (uint16_t*)calloc(pixelCount, sizeof(uint16_t));
+    tracked = shown && pixelMa ? pixelCount : 0;
+    counted = 0;
+    totalMa = 0;
+}
+
+void energyMode(uint8_t m, uint32_t ms)
+{
+    if (m == mode || m >= EnergyMaxModes)
+        return;
+    catchUp(ms);
+    mode = m;
+}
+
+void LAMP_HOT energyFrame(uint32_t ms, const uint8_t* pixels,
+                          size_t pixelCount, const uint8_t order[4])
+{
+    catchUp(ms);
+
+    if (pixelCount > tracked)
+        pixelCount = tracked;
+    // Pixels that have dropped off the end draw nothing any more.
+    for (size_t p = pixelCount; p < counted; p++) {
+        totalMa -= pixelMa[p];
+        pixelMa[p] = 0;
+        shown[p] = 0;
+    }
+    counted = pixelCount;
+
+    static const uint16_t channelMa[4] = {
+        milliampsR, milliampsG, milliampsB, milliampsW};
+    const uint16_t byteMa[4] = {channelMa[order[0]], channelMa[order[1]],
+                                channelMa[order[2]], channelMa[order[3]]};
+    for (size_t p = 0; p < pixelCount; p++) {
+        const uint8_t* px = pixels + p * 4;
+        uint32_t word;
+        memcpy(&word, px, sizeof(word));
+        if (word == shown[p])
+            continue;
+        shown[p] = word;
+
+        uint16_t ma = px[0] * byteMa[0] + px[1] * byteMa[1] +
+                      px[2] * byteMa[2] + px[3] * byteMa[3];
+        totalMa += ma - pixelMa[p];
+        pixelMa[p] = ma;
+    }
+    currentMa = milliampsIdle * pixelCount + totalMa / 255;
+}
+
+uint32_t energyMilliamps()
+{
+    return currentMa;
+}
+
+void energyGated(uint32_t ms)
+{
+    catchUp(ms);
+    currentMa = 0;
+}
+
+void energyReport(Print& out, uint32_t ms)
+{
+    catchUp(ms);
+
+    const uint64_t msPerHour = 3600000;
+    out.printf("energy now %umA\n", unsigned(currentMa));
+    for (int m = 0; m < EnergyMaxModes; m++) {
+        if (store.modeTime[m] == 0)
+            continue;
+        out.printf("energy mode %d: %us avg %umA %umAh\n", m,
+            unsigned(store.modeTime[m] / 1000),
+            unsigned(store.modeCharge[m] / store.modeTime[m]),
+            unsigned(store.modeCharge[m] / msPerHour));
+    }
+
+    // Oldest hour first.
+    uint32_t hour = store.uptime / msPerHour;
+    for (int h = EnergyHours - 1; h >= 0; h--) {
+        if (hour < uint32_t(h))
+            continue;
+        out.printf("energy hour -%d: %umAh\n", h,
+            unsigned(store.hourCharge[(hour - h) % EnergyHours] / msPerHour));
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+
+// Energy accounting.
+//
+// The current each frame draws is estimated from the per-channel model
+// below when the frame goes out, and charge is integrated from one frame to
+// the next. What each pixel draws is kept from frame to frame, so a frame
+// costs a compare per pixel, and the sum only for the pixels that changed.
+// Totals are kept per mode and for each of the last 24 hours of running, in
+// RTC memory so they survive deep sleep.
+
+// Rough current model for one pixel: mA drawn by each channel at 255, plus
+// what the controller draws when everything is off. 24 pixels x 104mA is
+// the 2.5A the lamp pulls fully lit.
+const uint16_t milliampsR = 24;
+const uint16_t milliampsG = 24;
+const uint16_t milliampsB = 24;
+const uint16_t milliampsW = 32;
+const uint16_t milliampsIdle = 1;
+
+const uint8_t EnergyMaxModes = 8;
+const uint8_t EnergyHours = 24;
+
+// estimateMilliamps reports how much current one pixel showing col draws.
+uint16_t estimateMilliamps(const RgbwColor& col);
+
+// energyBegin starts accounting at frame time ms, for frames of up to
+// pixelCount pixels, carrying on from the totals in RTC memory if they
+// survived.
+void energyBegin(uint32_t ms, size_t pixelCount);
+
+// energyMode notes that mode is running from frame time ms on.
+void energyMode(uint8_t mode, uint32_t ms);
+
+// energyFrame notes the frame about to go out at frame time ms. pixels is
+// the raw bus buffer and order[i] is the RGBW channel in byte i.
+void energyFrame(uint32_t ms, const uint8_t* pixels, size_t pixelCount,
+                 const uint8_t order[4]);
+
+// energyMilliamps is the estimated current of the frame that's out now.
+uint32_t energyMilliamps();
+
+// energyGated notes that the pixels' power was cut at frame time ms. The
+// next energyFrame() turns them back on.
+void energyGated(uint32_t ms);
+
+// energyReport prints the totals up to frame time ms.
+void energyReport(Print& out, uint32_t ms);
@@ -0,0 +1,91 @@
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <math.h>
+#include "frametime.h"
+
+// Stress reads a word from each cache line of this much flash in turn,
+// which is several times the cache, so every read misses.
+static const size_t StressBytes = 256 * 1024;
+static const size_t CacheLine = 32;
+
+static bool measuring;
+static uint32_t endAt;
+static bool stressed;
+static volatile bool stressing;
+
+// Running mean and variance, by Welford's method.
+static uint32_t frames;
+static double mean;
+static double m2;
+static uint32_t worst;
+
+static void stressTask(void*)
+{
+    const esp_partition_t* app = esp_partition_find_first(
+        ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, nullptr);
+    const void* mapped = nullptr;
+    spi_flash_mmap_handle_t handle;
+    size_t size = app && app->size < StressBytes ? app->size : StressBytes;
+
+    if (app && esp_partition_mmap(app, 0, size, SPI_FLASH_MMAP_DATA, &mapped,
+                                  &handle) == ESP_OK) {
+        const volatile uint32_t* words =
+            static_cast<const volatile uint32_t*>(mapped);
+        uint32_t sum = 0;
+        while (stressing) {
+            for (size_t i = 0; i < size / 4; i += CacheLine / 4)
+                sum += words[i];
+            // Let the idle task in, or the watchdog bites.
+            vTaskDelay(1);
+        }
+        (void)sum;
+        spi_flash_munmap(handle);
+    }
+    vTaskDelete(nullptr);
+}
+
+void frameTimeBegin(uint32_t now, uint32_t seconds, bool stress)
+{
+    frames = 0;
+    mean = 0;
+    m2 = 0;
+    worst = 0;
+    endAt = now + seconds * 1000;
+    stressed = stress;
+    measuring = true;
+
+    if (stress) {
+        stressing = true;
+        xTaskCreatePinnedToCore(stressTask, "stress", 2048, nullptr, 1,
+                                nullptr, 0);
+    }
+}
+
+void frameTimeSample(uint32_t now, uint32_t us, Print& out)
+{
+    if (!measuring)
+        return;
+
+    frames++;
+    double delta = us - mean;
+    mean += delta / frames;
+    m2 += delta * (us - mean);
+    if (us > worst)
+        worst = us;
+
+    if (int32_t(now - endAt) < 0)
+        return;
+    measuring = false;
+    stressing = false;
+
+#ifdef HOT_IN_FLASH
+    const char* placement = "flash";
+#else
+    const char* placement = "IRAM";
+#endif
+    double variance = frames > 1 ? m2 / (frames - 1) : 0;
+    out.printf("frame time, render path in %s%s: %u frames, mean %.1f us, "
+        "sd %.1f us, worst %u us\n", placement,
+        stressed ? ", flash busy" : "", unsigned(frames), mean,
+        sqrt(variance), unsigned(worst));
+}
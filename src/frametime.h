@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+#include <Print.h>
+
+// Frame time measurement, for seeing what placing the render path in IRAM
+// (hot.h) is worth.
+//
+// frameTimeBegin starts measuring how long each frame that shows something
+// takes to draw and send, for the given number of seconds, and then prints
+// the mean, standard deviation and worst case. With stress on, a task on
+// core 0 reads its way through flash the whole time, so that the render
+// core's cache misses have to queue for the flash behind it. That's where
+// code running from flash suffers, and code in IRAM doesn't.
+void frameTimeBegin(uint32_t now, uint32_t seconds, bool stress);
+
+// frameTimeSample records one frame's time, in us. Once the time is up it
+// prints the results to out.
+void frameTimeSample(uint32_t now, uint32_t us, Print& out);
@@ -0,0 +1,119 @@
+#include "gradient.h"
+
+gradient::gradient(uint16_t size) :
+    lut(new RgbwColor[size]),
+    size(size),
+    capacity(size)
+{
+}
+
+gradient::~gradient()
+{
+    delete[] lut;
+}
+
+void gradient::clear()
+{
+    stopCount = 0;
+    dirty = true;
+}
+
+void gradient::setStop(uint8_t index, uint16_t position, const RgbwColor& col)
+{
+    if (index > stopCount || index >= MaxGradientStops)
+        return;
+
+    if (index == stopCount) {
+        stopCount++;
+    } else if (stops[index].position == position && stops[index].col == col) {
+        return;
+    }
+
+    stops[index].position = position;
+    stops[index].col = col;
+    dirty = true;
+}
+
+void gradient::setBlend(gradientBlend b)
+{
+    dirty = dirty || b != blend;
+    blend = b;
+}
+
+void gradient::setWrap(bool w)
+{
+    dirty = dirty || w != wrap;
+    wrap = w;
+}
+
+void gradient::setSize(uint16_t n)
+{
+    if (n == 0 || n > capacity)
+        n = capacity;
+    dirty = dirty || n != size;
+    size = n;
+}
+
+// mix blends a to b by t/256.
+static uint8_t mix(uint8_t a, uint8_t b, int32_t t)
+{
+    return a + (((b - a) * t) >> 8);
+}
+
+bool gradient::bake()
+{
+    if (!dirty)
+        return false;
+    dirty = false;
+
+    if (stopCount == 0) {
+        for (uint16_t i = 0; i < size; i++)
+            lut[i] = RgbwColor(0);
+        return true;
+    }
+
+    // Positions are widened to 32 bits so the segment that wraps past the
+    // end can be handled like any other.
+    const uint32_t first = stops[0].position;
+    for (uint16_t i = 0; i < size; i++) {
+        uint32_t pos = uint32_t(i) * 65536 / size;
+
+        // Before the first stop: hold it, or carry on from the last stop.
+        if (pos < first && wrap)
+            pos += 65536;
+        uint8_t seg = 0;
+        while (seg + 1 < stopCount && pos >= stops[seg + 1].position)
+            seg++;
+
+        const stop& a = stops[seg];
+        uint32_t start = a.position;
+        uint32_t end;
+        const RgbwColor* bcol;
+        if (seg + 1 < stopCount) {
+            end = stops[seg + 1].position;
+            bcol = &stops[seg + 1].col;
+        } else if (wrap) {
+            end = first + 65536;
+            bcol = &stops[0].col;
+        } else {
+            end = start;
+            bcol = &a.col;
+        }
+
+        if (pos < start || end <= start) {
+            lut[i] = pos < start ? stops[0].col : a.col;
+            continue;
+        }
+
+        int32_t t = (pos - start) * 256 / (end - start);
+        if (blend == gradientSmooth)
+            t = (t * t * (768 - 2 * t)) >> 16;
+        else if (blend == gradientStep)
+            t = 0;
+
+        const RgbwColor& b = *bcol;
+        lut[i] = RgbwColor(mix(a.col.R, b.R, t), mix(a.col.G, b.G, t),
+                           mix(a.col.B, b.B, t), mix(a.col.W, b.W, t));
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <NeoPixelBus.h>
+
+// How the color changes between two stops.
+enum gradientBlend
+{
+    gradientLinear,
+    // Eases in and out of each stop.
+    gradientSmooth,
+    // Holds each stop's color until the next one.
+    gradientStep,
+};
+
+const uint8_t MaxGradientStops = 8;
+
+// gradient is a run of colors through up to MaxGradientStops stops, baked into
+// a table with one entry per pixel.
+//
+// Stops are placed at positions from 0 to 65535 along the table and must be
+// added in order. With wrap on, the last stop blends back round into the
+// first, which suits rings. The table is only rebuilt by bake(), and only if
+// a stop has actually changed since last time, so a mode can set its stops
+// every frame and still pay nothing for the gradient on frames where they
+// stay put.
+class gradient
+{
+public:
+    gradient(uint16_t size);
+    ~gradient();
+
+    void clear();
+    // setStop sets stop index, adding it if it's the next one.
+    void setStop(uint8_t index, uint16_t position, const RgbwColor& col);
+    void setBlend(gradientBlend b);
+    void setWrap(bool w);
+    // setSize sets how many table entries are in use, up to the size the
+    // gradient was made with.
+    void setSize(uint16_t n);
+
+    // bake rebuilds the table if anything changed. It returns true if it did.
+    bool bake();
+
+    // sample returns the color at index, offset along the gradient. Offsets
+    // wrap around the end of the table.
+    const RgbwColor& sample(uint16_t index, uint16_t offset = 0) const
+    {
+        return lut[(index + offset) % size];
+    }
+
+private:
+    struct stop
+    {
+        uint16_t position;
+        RgbwColor col;
+    };
+
+    stop stops[MaxGradientStops];
+    uint8_t stopCount = 0;
+    gradientBlend blend = gradientLinear;
+    bool wrap = false;
+    bool dirty = true;
+
+    RgbwColor* lut;
+    uint16_t size;
+    uint16_t capacity;
+};
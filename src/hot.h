@@ -0,0 +1,21 @@
+#pragma once
+#include <esp_attr.h>
+
+// LAMP_HOT puts a function that runs every frame in IRAM, so the lamp's own
+// per-pixel loops don't wait on the flash cache while something else is
+// keeping the flash busy. LAMP_HOT_DATA does the same for tables those
+// functions read, putting them in DRAM. What they call in the libraries,
+// LinearBlend, HslColor, std::function callbacks and Show(), stays in flash
+// and can still miss, so this makes stalls rarer and shorter, not gone.
+//
+// IRAM is scarce, so this is for the render path only: mode run()s and what
+// they call each frame, and the output stage. Build with -DHOT_IN_FLASH (the
+// hotflash env) to leave everything in flash, to see what it's worth with
+// the 't' serial command. tools/irambudget.py shows how much IRAM it costs.
+#ifdef HOT_IN_FLASH
+#define LAMP_HOT
+#define LAMP_HOT_DATA
+#else
+#define LAMP_HOT IRAM_ATTR
+#define LAMP_HOT_DATA DRAM_ATTR
+#endif
@@ -0,0 +1,45 @@
+#include "hues.h"
+#include "rng.h"
+
+void hueScheduler::begin()
+{
+    sequence = hueSequences[rngRandom(HueSequenceCount)];
+    position = rngRandom(HueBuckets);
+    offset = rngRandom(HueBuckets);
+    mirror = rngRandom(2);
+}
+
+void hueScheduler::setLuminance(float l)
+{
+    if (l == luminance)
+        return;
+
+    luminance = l;
+    for (uint8_t h = 0; h < HueBuckets; h++)
+        colors[h] = HslColor(float(h) / HueBuckets, 1.0f, luminance);
+}
+
+uint8_t hueScheduler::next()
+{
+    uint8_t h = sequence[position];
+    // Every sequence starts the way they all end up looping back to, so any
+    // of them can follow on.
+    if (++position == HueBuckets) {
+        position = 0;
+        sequence = hueSequences[rngRandom(HueSequenceCount)];
+    }
+
+    if (mirror)
+        h = (HueBuckets - h) % HueBuckets;
+    return (h + offset) % HueBuckets;
+}
+
+uint16_t hueScheduler::nextHue()
+{
+    return next() * 360 / HueBuckets;
+}
+
+const RgbwColor& hueScheduler::nextColor()
+{
+    return colors[next()];
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <NeoPixelBus.h>
+#include "huetable.h"
+
+// The colors the modes change to.
+//
+// Hues picked independently at random every so often land next to each
+// other, and a fade between them takes its full 15s to go nowhere. A
+// hueScheduler deals hues out of the sequences in huetable.h instead: every
+// hue is at least 60 degrees from the two dealt before it, and each pass
+// through a sequence deals every hue once. Where it starts, which way round
+// the wheel the sequences are read, and which sequence follows which are
+// random, so the lamp still never does the same thing twice.
+//
+// The color of every hue at the current luminance is worked out whenever
+// the luminance changes, so dealing a color is a table lookup.
+class hueScheduler
+{
+public:
+    // begin starts dealing from somewhere new, picked with rngRandom.
+    void begin();
+    // setLuminance works the colors out again, if luminance has changed.
+    void setLuminance(float luminance);
+
+    // nextHue deals a hue, in degrees, and nextColor deals the color of one.
+    uint16_t nextHue();
+    const RgbwColor& nextColor();
+
+private:
+    uint8_t next();
+
+    const uint8_t* sequence = hueSequences[0];
+    uint8_t position = 0;
+    // The sequences are turned round the wheel by offset, and read the
+    // other way round if mirror is set.
+    uint8_t offset = 0;
+    bool mirror = false;
+    float luminance = -1.0f;
+    RgbwColor colors[HueBuckets];
+};
@@ -0,0 +1,61 @@
+// Generated by tools/huetable.py, don't edit by hand.
+//
+// 16 sequences of the 36 hues, 10 degrees apart, each at least 60
+// degrees from the 2 before it. See hues.h.
+#pragma once
+#include <stdint.h>
+
+const uint8_t HueBuckets = 36;
+const uint8_t HueMinSeparation = 6;
+const uint8_t HueSequenceCount = 16;
+
+const uint8_t hueSequences[][36] = {
+    { 0, 18, 27,  3, 17, 24, 31, 13,  2, 26, 20,  8,
+     28, 34, 16,  7, 33, 19, 11, 25, 32, 14, 22,  6,
+     35, 23, 29,  5, 12, 21,  4, 10, 30,  1, 15,  9},
+    { 0, 18, 27, 35, 20, 29,  7,  1, 23, 30,  9,  3,
+     19, 25, 32, 13, 24,  4, 31, 22, 12,  6, 33, 17,
+     10, 34, 16,  8, 28, 14,  5, 21, 15,  2, 26, 11},
+    { 0, 18, 24,  8, 31,  1, 14, 29, 22, 16, 28,  2,
+     17, 25,  5, 35, 15,  7, 23, 13,  6, 34, 20, 27,
+      4, 33, 12, 19, 32, 11, 21, 30,  9,  3, 26, 10},
+    { 0, 18, 25, 34,  8, 27, 21,  2, 15, 28,  3, 12,
+     30, 19, 11,  4, 33, 16,  5, 29, 20,  9,  1, 17,
+     23, 32,  7, 22, 35, 14, 26,  6, 13, 31, 24, 10},
+    { 0, 18, 28, 35, 14, 24,  5, 31, 16,  4, 29, 21,
+      7,  1, 23, 15,  3, 32, 12,  2, 26,  9, 34, 19,
+     13, 33,  6, 25, 17, 11, 27, 20,  8, 30, 22, 10},
+    { 0, 18, 27,  1, 12, 28, 21,  3, 33, 11,  4, 30,
+     13, 23, 35,  8, 22, 32, 15, 24,  7, 34, 25,  9,
+     19,  2, 29, 16,  6, 31, 14, 20,  5, 26, 17, 10},
+    { 0, 18, 28, 10, 17, 23,  3, 32, 20,  9, 29, 35,
+     11, 24, 31, 13, 19,  7,  1, 16, 27,  5, 21, 12,
+     34, 25,  6, 14, 33,  4, 22, 30, 15,  2, 26,  8},
+    { 0, 18, 25,  4, 10, 28, 35,  8, 29, 16,  2, 27,
+     11, 19, 30,  3, 22,  9, 34, 21, 14,  5, 24, 33,
+      6, 20, 13,  1, 23, 17, 31,  7, 15, 32, 26, 12},
+    { 0, 18, 30, 12, 24, 34, 11, 22,  5, 28, 19,  9,
+     32,  2,  8, 14, 26,  4, 13, 31,  7, 15, 25,  6,
+     17, 27,  1, 16, 23,  3, 33, 20, 10, 35, 21, 29},
+    { 0, 18,  6, 24, 30, 13,  4, 27, 11, 33, 17,  3,
+     29,  9, 23, 15,  8,  2, 21, 14,  1, 28, 10, 35,
+     19,  7, 31, 25, 12, 34, 22, 16,  5, 32, 20, 26},
+    { 0, 18, 11, 32, 21,  8, 14, 24,  6, 13, 25,  5,
+     15, 33,  3, 27, 20, 35, 10, 23, 30, 12,  2, 29,
+     16,  1, 22,  7, 31, 17,  4, 26, 19, 34, 28,  9},
+    { 0, 18, 29,  2, 17, 28,  6, 14, 32, 26,  4, 20,
+     10, 34, 23, 11,  3, 31, 25, 12, 19, 35,  9, 21,
+     15,  7, 33, 27,  8,  1, 16, 22,  5, 30, 13, 24},
+    { 0, 18, 12, 29, 35, 10, 22, 33,  3, 21, 32,  5,
+     14, 23, 34, 13, 26,  2, 19,  8, 28, 16,  9, 24,
+     30, 17,  1, 11, 25,  4, 15, 31,  7, 20, 27,  6},
+    { 0, 18,  7, 26, 16, 35, 24,  8, 30,  1, 15, 21,
+     28,  9, 19, 25, 10, 32, 22, 12,  5, 20, 31, 11,
+      3, 29, 17,  2, 27, 13, 34, 23,  4, 33, 14,  6},
+    { 0, 18, 28,  5, 22, 14,  7, 32, 21, 13, 34, 25,
+      4, 17, 10, 33, 27,  3,  9, 15,  1, 30, 24, 12,
+      2, 26, 11, 19, 29, 35, 23, 16,  6, 31, 20,  8},
+    { 0, 18, 29,  5, 20, 13, 27, 33, 10,  4, 21, 32,
+      6, 25, 35,  7, 24, 30,  2, 16,  9,  1, 15, 22,
+     31, 11, 17, 23,  3, 14, 26,  8, 19, 34, 28, 12},
+};
@@ -0,0 +1,378 @@
+#include "kernels.h"
+#include "hot.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+// A 4x4 Bayer matrix, spread over 0..255 and laid out twice over so a vector
+// can load 16 steps of it starting anywhere in the first copy.
+static const uint16_t ditherPattern[32] = {
+    0, 128, 32, 160, 192, 64, 224, 96, 48, 176, 16, 144, 240, 112, 208, 80,
+    0, 128, 32, 160, 192, 64, 224, 96, 48, 176, 16, 144, 240, 112, 208, 80,
+};
+
+//
+// Scalar
+//
+// blend uses a * (256 - t) + b * t rather than a + (b - a) * t, which is the
+// same after the shift but never goes negative, so vector versions can do it
+// in unsigned 16 bit lanes.
+static void blendScalar(uint8_t* dst, const uint8_t* a, const uint8_t* b,
+                        size_t n, uint8_t t)
+{
+    const uint16_t ta = 256 - t;
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (a[i] * ta + b[i] * t) >> 8;
+}
+
+static void compositeScalar(uint8_t* dst, const uint8_t* src, size_t n,
+                            uint8_t alpha)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint16_t v = dst[i] + ((src[i] * alpha) >> 8);
+        dst[i] = v > 255 ? 255 : v;
+    }
+}
+
+// The output stage runs this every frame to apply brightness.
+static void LAMP_HOT gammaScalar(uint8_t* dst, const uint8_t* src, size_t n,
+                                 const uint8_t table[256])
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = table[src[i]];
+}
+
+static void ditherScalar(uint8_t* dst, const uint16_t* src, size_t n,
+                         uint8_t phase)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t v = src[i] + ditherPattern[(i + phase) & 15];
+        dst[i] = v > 0xffff ? 255 : v >> 8;
+    }
+}
+
+const pixelKernels scalarKernels = {
+    "scalar",
+    blendScalar,
+    compositeScalar,
+    gammaScalar,
+    ditherScalar,
+};
+
+#ifdef KERNELS_X86
+//
+// SSE2, 16 channels at a time. The tails go through the scalar kernels.
+//
+__attribute__((target("sse2")))
+static void blendSse2(uint8_t* dst, const uint8_t* a, const uint8_t* b,
+                      size_t n, uint8_t t)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i tb = _mm_set1_epi16(t);
+    const __m128i ta = _mm_set1_epi16(256 - t);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i lo = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), ta),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), tb));
+        __m128i hi = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), ta),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), tb));
+        _mm_storeu_si128((__m128i*)(dst + i),
+            _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    blendScalar(dst + i, a + i, b + i, n - i, t);
+}
+
+__attribute__((target("sse2")))
+static void compositeSse2(uint8_t* dst, const uint8_t* src, size_t n,
+                          uint8_t alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i va = _mm_set1_epi16(alpha);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i lo = _mm_srli_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), va), 8);
+        __m128i hi = _mm_srli_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), va), 8);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i),
+            _mm_adds_epu8(d, _mm_packus_epi16(lo, hi)));
+    }
+    compositeScalar(dst + i, src + i, n - i, alpha);
+}
+
+// SSE2 has no gather, so the table lookups stay scalar; unrolling is all
+// there is to gain.
+static void gammaSse2(uint8_t* dst, const uint8_t* src, size_t n,
+                      const uint8_t table[256])
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        dst[i] = table[src[i]];
+        dst[i + 1] = table[src[i + 1]];
+        dst[i + 2] = table[src[i + 2]];
+        dst[i + 3] = table[src[i + 3]];
+    }
+    gammaScalar(dst + i, src + i, n - i, table);
+}
+
+__attribute__((target("sse2")))
+static void ditherSse2(uint8_t* dst, const uint16_t* src, size_t n,
+                       uint8_t phase)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint16_t* pattern = ditherPattern + ((i + phase) & 15);
+        __m128i lo = _mm_adds_epu16(
+            _mm_loadu_si128((const __m128i*)(src + i)),
+            _mm_loadu_si128((const __m128i*)pattern));
+        __m128i hi = _mm_adds_epu16(
+            _mm_loadu_si128((const __m128i*)(src + i + 8)),
+            _mm_loadu_si128((const __m128i*)(pattern + 8)));
+        _mm_storeu_si128((__m128i*)(dst + i),
+            _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    // The scalar tail has to carry on the pattern from where it got to.
+    for (; i < n; i++) {
+        uint32_t v = src[i] + ditherPattern[(i + phase) & 15];
+        dst[i] = v > 0xffff ? 255 : v >> 8;
+    }
+}
+
+static const pixelKernels sse2Kernels = {
+    "sse2",
+    blendSse2,
+    compositeSse2,
+    gammaSse2,
+    ditherSse2,
+};
+
+//
+// AVX2, 32 channels at a time. Packing works within each 128 bit half, so
+// widening uses cvtepu8 on each half instead of unpack, and the results are
+// put back in order with a permute.
+//
+__attribute__((target("avx2")))
+static inline __m256i packHalves(__m256i lo, __m256i hi)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8);
+}
+
+__attribute__((target("avx2")))
+static void blendAvx2(uint8_t* dst, const uint8_t* a, const uint8_t* b,
+                      size_t n, uint8_t t)
+{
+    const __m256i tb = _mm256_set1_epi16(t);
+    const __m256i ta = _mm256_set1_epi16(256 - t);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i r[2];
+        for (int h = 0; h < 2; h++) {
+            __m256i va = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(a + i + h * 16)));
+            __m256i vb = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(b + i + h * 16)));
+            r[h] = _mm256_srli_epi16(_mm256_add_epi16(
+                _mm256_mullo_epi16(va, ta), _mm256_mullo_epi16(vb, tb)), 8);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + i), packHalves(r[0], r[1]));
+    }
+    blendScalar(dst + i, a + i, b + i, n - i, t);
+}
+
+__attribute__((target("avx2")))
+static void compositeAvx2(uint8_t* dst, const uint8_t* src, size_t n,
+                          uint8_t alpha)
+{
+    const __m256i va = _mm256_set1_epi16(alpha);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i r[2];
+        for (int h = 0; h < 2; h++) {
+            __m256i s = _mm256_cvtepu8_epi16(
+                _mm_loadu_si128((const __m128i*)(src + i + h * 16)));
+            r[h] = _mm256_srli_epi16(_mm256_mullo_epi16(s, va), 8);
+        }
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i),
+            _mm256_adds_epu8(d, packHalves(r[0], r[1])));
+    }
+    compositeScalar(dst + i, src + i, n - i, alpha);
+}
+
+// gammaAvx2 gathers from a copy of the table widened to 32 bits, 8 channels
+// per gather.
+__attribute__((target("avx2")))
+static void gammaAvx2(uint8_t* dst, const uint8_t* src, size_t n,
+                      const uint8_t table[256])
+{
+    int32_t wide[256];
+    for (int i = 0; i < 256; i++)
+        wide[i] = table[i];
+
+    const __m256i pick = _mm256_setr_epi8(
+        0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i gather = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((const __m128i*)(src + i)));
+        __m256i v = _mm256_i32gather_epi32(wide, idx, 4);
+        // Take the low byte of each lane and bring them together.
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pick),
+                                        gather);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm256_castsi256_si128(v));
+    }
+    gammaScalar(dst + i, src + i, n - i, table);
+}
+
+__attribute__((target("avx2")))
+static void ditherAvx2(uint8_t* dst, const uint16_t* src, size_t n,
+                       uint8_t phase)
+{
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        // Both halves start 16 steps apart, which is the same place in the
+        // pattern.
+        __m256i pattern = _mm256_loadu_si256(
+            (const __m256i*)(ditherPattern + ((i + phase) & 15)));
+        __m256i lo = _mm256_adds_epu16(
+            _mm256_loadu_si256((const __m256i*)(src + i)), pattern);
+        __m256i hi = _mm256_adds_epu16(
+            _mm256_loadu_si256((const __m256i*)(src + i + 16)), pattern);
+        _mm256_storeu_si256((__m256i*)(dst + i), packHalves(
+            _mm256_srli_epi16(lo, 8), _mm256_srli_epi16(hi, 8)));
+    }
+    for (; i < n; i++) {
+        uint32_t v = src[i] + ditherPattern[(i + phase) & 15];
+        dst[i] = v > 0xffff ? 255 : v >> 8;
+    }
+}
+
+static const pixelKernels avx2Kernels = {
+    "avx2",
+    blendAvx2,
+    compositeAvx2,
+    gammaAvx2,
+    ditherAvx2,
+};
+
+//
+// AVX-512 (BW and VL), 32 channels at a time, with masked loads and stores
+// for the tails instead of falling back to scalar. The conversions use their
+// zero-masked forms too: the plain ones start from an undefined vector,
+// which GCC warns about once they're inlined.
+//
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void blendAvx512(uint8_t* dst, const uint8_t* a, const uint8_t* b,
+                        size_t n, uint8_t t)
+{
+    const __m512i tb = _mm512_set1_epi16(t);
+    const __m512i ta = _mm512_set1_epi16(256 - t);
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 m = n - i >= 32 ? 0xffffffffu : (1u << (n - i)) - 1;
+        __m512i va = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, a + i));
+        __m512i vb = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, b + i));
+        __m512i r = _mm512_srli_epi16(_mm512_add_epi16(
+            _mm512_mullo_epi16(va, ta), _mm512_mullo_epi16(vb, tb)), 8);
+        _mm256_mask_storeu_epi8(dst + i, m, _mm512_maskz_cvtepi16_epi8(m, r));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void compositeAvx512(uint8_t* dst, const uint8_t* src, size_t n,
+                            uint8_t alpha)
+{
+    const __m512i va = _mm512_set1_epi16(alpha);
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 m = n - i >= 32 ? 0xffffffffu : (1u << (n - i)) - 1;
+        __m512i s = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, src + i));
+        __m256i add = _mm512_maskz_cvtepi16_epi8(m,
+            _mm512_srli_epi16(_mm512_mullo_epi16(s, va), 8));
+        __m256i d = _mm256_maskz_loadu_epi8(m, dst + i);
+        _mm256_mask_storeu_epi8(dst + i, m, _mm256_adds_epu8(d, add));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void gammaAvx512(uint8_t* dst, const uint8_t* src, size_t n,
+                        const uint8_t table[256])
+{
+    int32_t wide[256];
+    for (int i = 0; i < 256; i++)
+        wide[i] = table[i];
+
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 m = n - i >= 16 ? 0xffff : (1u << (n - i)) - 1;
+        __m512i idx = _mm512_maskz_cvtepu8_epi32(m,
+            _mm_maskz_loadu_epi8(m, src + i));
+        __m512i v = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), m,
+                                                idx, wide, 4);
+        _mm_mask_storeu_epi8(dst + i, m, _mm512_maskz_cvtepi32_epi8(m, v));
+    }
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static void ditherAvx512(uint8_t* dst, const uint16_t* src, size_t n,
+                         uint8_t phase)
+{
+    // 32 steps is two runs through the pattern, so every vector starts in
+    // the same place in it.
+    const __m256i half = _mm256_loadu_si256(
+        (const __m256i*)(ditherPattern + (phase & 15)));
+    const __m512i pattern = _mm512_maskz_broadcast_i64x4(0xff, half);
+    for (size_t i = 0; i < n; i += 32) {
+        __mmask32 m = n - i >= 32 ? 0xffffffffu : (1u << (n - i)) - 1;
+        __m512i v = _mm512_adds_epu16(_mm512_maskz_loadu_epi16(m, src + i),
+                                      pattern);
+        _mm256_mask_storeu_epi8(dst + i, m,
+            _mm512_maskz_cvtepi16_epi8(m, _mm512_srli_epi16(v, 8)));
+    }
+}
+
+static const pixelKernels avx512Kernels = {
+    "avx512",
+    blendAvx512,
+    compositeAvx512,
+    gammaAvx512,
+    ditherAvx512,
+};
+#endif
+
+size_t kernelVariants(const pixelKernels** variants, size_t max)
+{
+    size_t count = 0;
+    if (count < max)
+        variants[count++] = &scalarKernels;
+
+#ifdef KERNELS_X86
+    __builtin_cpu_init();
+    if (count < max && __builtin_cpu_supports("sse2"))
+        variants[count++] = &sse2Kernels;
+    if (count < max && __builtin_cpu_supports("avx2"))
+        variants[count++] = &avx2Kernels;
+    if (count < max && __builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl"))
+        variants[count++] = &avx512Kernels;
+#endif
+    return count;
+}
+
+const pixelKernels& bestKernels()
+{
+    static const pixelKernels* best = nullptr;
+    if (!best) {
+        const pixelKernels* variants[4];
+        best = variants[kernelVariants(variants, 4) - 1];
+    }
+    return *best;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Pixel kernels that work on raw channel bytes, so they don't care about
+// channel order or how many channels a pixel has. n is always a count of
+// channels (bytes out), not pixels.
+//
+// scalarKernels is the reference, and the only set on the ESP32. x86 builds
+// also get SSE2, AVX2 and AVX-512 sets, picked at run time from what the CPU
+// supports. Every set gives exactly the same bytes as the scalar one.
+struct pixelKernels
+{
+    const char* name;
+    // blend sets dst to a + (b - a) * t / 256, rounding down.
+    void (*blend)(uint8_t* dst, const uint8_t* a, const uint8_t* b, size_t n,
+                  uint8_t t);
+    // composite adds src * alpha / 256 to dst, saturating, as light from two
+    // layers adds up.
+    void (*composite)(uint8_t* dst, const uint8_t* src, size_t n,
+                      uint8_t alpha);
+    // gamma looks every channel up in table.
+    void (*gamma)(uint8_t* dst, const uint8_t* src, size_t n,
+                  const uint8_t table[256]);
+    // dither takes 8.8 fixed point channels down to 8 bits with a 16 step
+    // ordered dither. phase shifts the pattern, so changing it each frame
+    // moves the dither about.
+    void (*dither)(uint8_t* dst, const uint16_t* src, size_t n,
+                   uint8_t phase);
+};
+
+extern const pixelKernels scalarKernels;
+
+// kernelVariants fills variants with every set this CPU can run, scalar
+// first and fastest last, and returns how many there are.
+size_t kernelVariants(const pixelKernels** variants, size_t max);
+
+// bestKernels returns the fastest set this CPU can run. The output stage
+// applies brightness with its gamma.
+const pixelKernels& bestKernels();
@@ -0,0 +1,181 @@
+#include <Arduino.h>
+#include "life.h"
+#include "rng.h"
+#include "hot.h"
+
+life::life(uint16_t width, uint16_t height) :
+    w(width),
+    h(height),
+    stride((width + 31) / 32)
+{
+    lastMask = width % 32 ? (1u << (width % 32)) - 1 : 0xffffffffu;
+    cells = new uint32_t[stride * h];
+    next = new uint32_t[stride * h];
+    ages = new uint8_t[w * h];
+    clear();
+}
+
+life::~life()
+{
+    delete[] cells;
+    delete[] next;
+    delete[] ages;
+}
+
+void life::clear()
+{
+    memset(cells, 0, stride * h * sizeof(uint32_t));
+    memset(ages, 0, w * h);
+}
+
+void life::saveAges(uint8_t* out) const
+{
+    memcpy(out, ages, w * h);
+}
+
+void life::loadAges(const uint8_t* in)
+{
+    memset(cells, 0, stride * h * sizeof(uint32_t));
+    for (uint16_t y = 0; y < h; y++)
+        for (uint16_t x = 0; x < w; x++)
+            if (in[y * w + x] >= 128)
+                cells[y * stride + x / 32] |= 1u << (x % 32);
+    memcpy(ages, in, w * h);
+}
+
+void life::seed(uint8_t density)
+{
+    for (uint16_t y = 0; y < h; y++)
+        for (uint16_t x = 0; x < w; x++)
+            set(x, y, uint8_t(rngRandom(256)) < density);
+}
+
+void life::set(uint16_t x, uint16_t y, bool alive)
+{
+    uint32_t& word = cells[y * stride + x / 32];
+    uint32_t bit = 1u << (x % 32);
+    if (alive) {
+        word |= bit;
+        ages[y * w + x] = 128;
+    } else {
+        word &= ~bit;
+        ages[y * w + x] = 0;
+    }
+}
+
+bool life::get(uint16_t x, uint16_t y) const
+{
+    return (cells[y * stride + x / 32] >> (x % 32)) & 1;
+}
+
+// Adders on 32 one bit numbers at a time.
+static inline void fullAdd(uint32_t a, uint32_t b, uint32_t c, uint32_t& sum,
+                           uint32_t& carry)
+{
+    uint32_t ab = a ^ b;
+    sum = ab ^ c;
+    carry = (a & b) | (ab & c);
+}
+
+static inline void halfAdd(uint32_t a, uint32_t b, uint32_t& sum,
+                           uint32_t& carry)
+{
+    sum = a ^ b;
+    carry = a & b;
+}
+
+uint32_t LAMP_HOT life::step()
+{
+    const uint16_t last = stride - 1;
+    // Where the cell at the far end of a row sits in its word.
+    const uint8_t endBit = (w - 1) % 32;
+    uint32_t population = 0;
+
+    for (uint16_t y = 0; y < h; y++) {
+        const uint32_t* rows[3] = {
+            cells + (y ? y - 1 : h - 1) * stride,
+            cells + y * stride,
+            cells + (y + 1 < h ? y + 1 : 0) * stride,
+        };
+        uint32_t* out = next + y * stride;
+
+        for (uint16_t k = 0; k < stride; k++) {
+            // For each row, the cells themselves and their neighbours to the
+            // west and east, lined up with them. Rows wrap round at the ends.
+            uint32_t n[9];
+            for (int r = 0; r < 3; r++) {
+                const uint32_t* row = rows[r];
+                uint32_t word = row[k];
+                uint32_t west = word << 1;
+                west |= k ? row[k - 1] >> 31 : (row[last] >> endBit) & 1;
+                uint32_t east = word >> 1;
+                if (k < last)
+                    east |= row[k + 1] << 31;
+                else
+                    east |= (row[0] & 1) << endBit;
+                n[r * 3] = west;
+                n[r * 3 + 1] = word;
+                n[r * 3 + 2] = east;
+            }
+            uint32_t alive = n[4];
+
+            // Sum the eight neighbours. Only bits 0, 1 and 2 of the count
+            // matter: eight neighbours comes out as zero, which is dead
+            // either way.
+            uint32_t sa, ca, sb, cb, sc, cc;
+            fullAdd(n[0], n[1], n[2], sa, ca);
+            fullAdd(n[3], n[5], n[6], sb, cb);
+            halfAdd(n[7], n[8], sc, cc);
+            uint32_t bit0, cd;
+            fullAdd(sa, sb, sc, bit0, cd);
+            uint32_t t, ce;
+            fullAdd(ca, cb, cc, t, ce);
+            uint32_t bit1 = t ^ cd;
+            uint32_t bit2 = ce ^ (t & cd);
+
+            // Two or three neighbours and alive, or exactly three.
+            uint32_t result = bit1 & ~bit2 & (bit0 | alive);
+            if (k == last)
+                result &= lastMask;
+            out[k] = result;
+            population += __builtin_popcount(result);
+        }
+        ageRow(y, rows[1], out);
+    }
+
+    uint32_t* t = cells;
+    cells = next;
+    next = t;
+    return population;
+}
+
+void LAMP_HOT life::ageRow(uint16_t y, const uint32_t* before,
+                           const uint32_t* after)
+{
+    uint8_t* age = ages + y * w;
+    for (uint16_t k = 0; k < stride; k++) {
+        uint32_t now = after[k];
+        uint32_t born = now & ~before[k];
+        uint32_t died = before[k] & ~now;
+        uint16_t end = k < stride - 1 ? 32 : w - k * 32;
+
+        for (uint16_t i = 0; i < end; i++) {
+            uint8_t& a = age[k * 32 + i];
+            uint32_t bit = 1u << i;
+            if (born & bit)
+                a = 128;
+            else if (died & bit)
+                a = LifeGlow;
+            else if (now & bit) {
+                if (a < 255)
+                    a++;
+            } else if (a)
+                a--;
+        }
+    }
+}
+
+sprite life::image(const RgbwColor* palette) const
+{
+    return sprite{w, h, ages, palette, 256, -1};
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include "matrix.h"
+
+// How many generations a dead cell keeps glowing for.
+const uint8_t LifeGlow = 24;
+
+// life is Conway's Game of Life on a width x height torus.
+//
+// Cells are packed 32 to a word along each row, and step() works out a whole
+// word of cells at once: the eight neighbours of every cell in the word are
+// summed with bit-sliced adders, so a generation costs a few dozen logic ops
+// per 32 cells. Alongside the bits, every cell has an age byte, which is what
+// gets drawn:
+//   0            long dead
+//   1..127       dead, glowing for that many more generations
+//   128..255     alive, for (age - 128) generations, counting up to 127
+// so image() can be blitted through a 256 entry palette that fades cells in
+// and out.
+class life
+{
+public:
+    life(uint16_t width, uint16_t height);
+    ~life();
+
+    uint16_t width() const {return w;}
+    uint16_t height() const {return h;}
+
+    // seed fills the grid at random, with each cell alive with probability
+    // density/256.
+    void seed(uint8_t density);
+    void clear();
+    void set(uint16_t x, uint16_t y, bool alive);
+    bool get(uint16_t x, uint16_t y) const;
+
+    // saveAges copies out the w * h ages, which is the whole state of the
+    // grid, and loadAges puts them back.
+    void saveAges(uint8_t* out) const;
+    void loadAges(const uint8_t* in);
+
+    // step advances one generation. It returns how many cells are alive.
+    uint32_t step();
+
+    // image returns the ages as a sprite drawn through palette, which must
+    // have 256 entries.
+    sprite image(const RgbwColor* palette) const;
+
+private:
+    void ageRow(uint16_t y, const uint32_t* before, const uint32_t* after);
+
+    uint16_t w;
+    uint16_t h;
+    // Words per row.
+    uint16_t stride;
+    // The bits in use in the last word of each row.
+    uint32_t lastMask;
+    uint32_t* cells;
+    uint32_t* next;
+    uint8_t* ages;
+};
@@ -1,6 +1,31 @@
 #include <NeoPixelBus.h>
-#include <NeoPixelAnimator.h>
 #include <functional>
+#include <rom/rtc.h>
+#include "animator.h"
+#include "ddafade.h"
+#include "gradient.h"
+#include "whitetable.h"
+#include "calibration.h"
+#include "bench.h"
+#include "recorder.h"
+#include "ambient.h"
+#include "energy.h"
+#include "config.h"
+#include "seqlock.h"
+#include "mqtt.h"
+#include "matrix.h"
+#include "life.h"
+#include "modulation.h"
+#include "viewer.h"
+#include "rng.h"
+#include "hot.h"
+#include "frametime.h"
+#include "encoder.h"
+#include "checksum.h"
+#include "playback.h"
+#include "snapshot.h"
+#include "hues.h"
+#include <Preferences.h>
 
 // This firmware is for an ESP32 board connected to a NeoPixel ring, housed
 // inside a mathmos light whose original electronics stopped working.
@@ -10,11 +35,16 @@
 //
 // Mode1: Close to the mathos' original animation, it fades slowly from one
 //        color to the next. White is not used.
+// Mode3: Tunable white, 2200K-6500K. Mostly the W channel, with a little R, G
+//        or B mixed in to move the color temperature.
+// Mode4: Two comets chase each other around the ring, leaving trails that
+//        fade out behind them.
 
 // Pin 12 is connected to the switch and will read high when the switch is
 // pressed.
 // Pin 21 is the output to the neopixel bus.
 
+// The most pixels the lamp can drive. The config says how many are fitted.
 const uint16_t PixelCount = 24;
 const uint8_t SwitchPin = 12;
 const uint8_t PixelPin = 13;
@@ -24,22 +54,322 @@ const uint8_t PixelPin = 13;
 // undefine RELEASE to lower the power requirements.
 #define RELEASE
 
+// Define this if there's a light sensor on LightChannel (GPIO34, A2 on the
+// feather) to have the lamp dim itself in the dark.
+//#define AMBIENT_SENSOR
+#ifdef AMBIENT_SENSOR
+const adc1_channel_t LightChannel = ADC1_CHANNEL_6;
+#endif
+
+// Define this if the pixels' supply is switched by a MOSFET on RailPin (high
+// for on). Once the output has been all black for RailOffDelay ms the rail is
+// cut, since each pixel still draws about a milliamp showing nothing.
+//#define RAIL_SWITCH
+const uint8_t RailPin = 27;
+const uint16_t RailOffDelay = 2000;
+// How long the pixels need after power comes back before they take data.
+const uint16_t RailPowerUpMs = 5;
+
+// Define this if there's a matrix panel chained on after the ring, on the
+// same data line. Its first pixel follows the last fitted ring pixel.
+//#define PANEL
+#ifdef PANEL
+const uint16_t PanelWidth = 16;
+const uint16_t PanelHeight = 16;
+const matrixLayout PanelLayout = matrixSerpentine;
+#else
+const uint16_t PanelWidth = 0;
+const uint16_t PanelHeight = 0;
+const matrixLayout PanelLayout = matrixRows;
+#endif
+const uint16_t PanelPixels = PanelWidth * PanelHeight;
+// Everything on the data line.
+const uint16_t BusPixels = PixelCount + PanelPixels;
+
+// Define this if there's a rotary encoder on EncoderPinA and EncoderPinB
+// (common to ground). Each detent moves the brightness by
+// EncoderBrightnessStep, or with encoderSpeed set in the config, makes the
+// modes EncoderSpeedStep faster or slower. An ambient sensor, if there is
+// one, still has the last word on brightness.
+//#define ENCODER
+const uint8_t EncoderPinA = 32;
+const uint8_t EncoderPinB = 33;
+const uint8_t EncoderBrightnessStep = 8;
+const float EncoderSpeedStep = 0.9f;
+
+// Define this to add a mode that plays a show from an SD card, on the
+// feather's SPI pins with chip select on SdCsPin. 33 is where the Adalogger
+// FeatherWing has it, so move the encoder if there's one of those too. See
+// playback.h; tools/render.py --show makes show files. Host builds can play
+// a show from elsewhere with -DSHOW_PATH.
+//#define SD_PLAYBACK
+const uint8_t SdCsPin = 33;
+#ifndef SHOW_PATH
+#define SHOW_PATH "/sd/show.lsh"
+#endif
+const char* const ShowPath = SHOW_PATH;
+
+// The host build can publish every frame to a live viewer with -DVIEWER;
+// see viewer.h and tools/viewer.py.
+
+// MQTT control is built in with -DMQTT_CONTROL, along with the WiFi and
+// broker settings; see mqtt.h and the mqtt env in platformio.ini.
+
 #ifdef RELEASE
-const uint8_t saturation = 220;
-const float luminance = 0.5f;
+const uint8_t defaultSaturation = 220;
+const float defaultLuminance = 0.5f;
 #else
-const uint8_t saturation = 80;
-const float luminance = 0.05f;
+const uint8_t defaultSaturation = 80;
+const float defaultLuminance = 0.05f;
 #endif
 
+// The settings in use. See config.h; these are the defaults, which flash or
+// Serial can override.
+lampConfig config = {
+    15000,  // fadeDelay: 15s between colors?
+    200,    // rotateDelay
+    20000,  // switchColsDelay
+    defaultSaturation,
+    defaultLuminance,
+    PixelCount,
+    255,    // maxBrightness
+    WhiteDieKelvin,
+    0,      // fadeWander
+    0,      // rotateSwing
+    60000,  // swingPeriod
+    0,      // encoderSpeed
+};
+
+// Modulation of the mode timings; see modulation.h. The depths come from
+// the config, in tuneModulation().
+modGraph mods;
+// A slow random walk on the time it takes to change colors.
+modSource wander;
+// Eases the rotator's swing in when it starts.
+modSource swingIn;
+// The swing on the rotator's step time.
+modSource swing;
+
+// Where the modes get their colors from; see hues.h.
+hueScheduler hues;
+
 NeoGamma<NeoGammaTableMethod> cgamma;
-NeoPixelBus<NeoRgbwFeature, NeoWs2813Method> ring(PixelCount, PixelPin);
+NeoPixelBus<NeoRgbwFeature, NeoWs2813Method> ring(BusPixels, PixelPin);
+
+// NeoRgbwFeature sends the channels as G, R, B, W. This is which RGBW
+// channel goes out in each byte.
+const uint8_t wireOrder[4] = {1, 0, 2, 3};
+
+colorCalibration calibration;
+uint8_t pixelGains[BusPixels * 4];
+// The calibration with the global brightness folded in. This is what the
+// output stage actually applies.
+colorCalibration output;
+uint8_t outputBrightness = 255;
+// What the mode drew, kept aside while the corrected frame goes out. Offline
+// renders put the corrected frame here instead; see outputFrame().
+uint8_t modeFrame[BusPixels * 4];
+
+// Set by show(), so runMode() knows the frame drew something worth timing.
+bool frameShown = false;
+
+// Set while renderOffline() is running a mode. It sends the frames itself,
+// so show() leaves the ring alone.
+bool rendering = false;
+
+// show is the output stage. Modes draw into the ring and call this instead of
+// ring.Show(). Corrections are made on the way out and the ring is put back
+// the way the mode left it afterwards, so they never feed back into modes
+// that build on the previous frame.
+// setBrightness dims everything the modes draw to level/255, or further if
+// the config caps it.
+void setBrightness(uint8_t level)
+{
+    outputBrightness = level;
+    if (level > config.maxBrightness)
+        level = config.maxBrightness;
+    scaleCalibration(calibration, level, output);
+}
+
+// Set when a remote command has been applied but no frame showing it has
+// gone out yet. commandReceived is when it arrived, in micros().
+bool commandPending = false;
+commandType commandKind;
+uint32_t commandReceived;
+
+// Power rail state. outputBlack is set while the frames going out are all
+// black, since frame time blackSince. railHeld is set while a frame waits
+// for the pixels to power up.
+bool railOn = true;
+bool railWarming = false;
+bool railHeld = false;
+uint32_t railWokeAt;
+bool outputBlack = false;
+uint32_t blackSince;
+// Time spent with the rail off, and how many times it's been cut.
+uint32_t railOffAt;
+uint32_t railGatedMs = 0;
+uint32_t railGates = 0;
+
+void setRail(bool on)
+{
+    railOn = on;
+    digitalWrite(RailPin, on ? HIGH : LOW);
+}
+
+// railWake powers the pixels back up. Calling it as soon as it's known that
+// something is about to be drawn hides the power up time.
+void railWake()
+{
+    if (railOn)
+        return;
+
+    setRail(true);
+    railWarming = true;
+    railWokeAt = millis();
+    railGatedMs += frameMillis - railOffAt;
+}
+
+// railReady notes whether the frame in pixels is all black, and makes sure
+// the pixels have power if it isn't. It returns false when the rail is off
+// and there's no need to send the frame at all, and when the pixels are
+// still powering up. Rather than wait for them, the frame is held, and
+// railCheck() sends it as soon as they're ready.
+bool railReady(const uint8_t* pixels, size_t size)
+{
+#ifdef RAIL_SWITCH
+    uint8_t lit = 0;
+    for (size_t i = 0; i < size; i++)
+        lit |= pixels[i];
+
+    if (!lit)
+    {
+        if (!outputBlack)
+        {
+            outputBlack = true;
+            blackSince = frameMillis;
+        }
+        return railOn;
+    }
+
+    outputBlack = false;
+    railWake();
+    railHeld = railWarming && millis() - railWokeAt < RailPowerUpMs;
+    if (railHeld)
+        return false;
+    railWarming = false;
+#endif
+    return true;
+}
+
+void railReport(Print& out)
+{
+    uint32_t gated = railGatedMs;
+    if (!railOn)
+        gated += frameMillis - railOffAt;
+    out.printf("rail %s, off %us in total, cut %u times\n",
+        railOn ? "on" : "off", unsigned(gated / 1000), unsigned(railGates));
+}
+
+// panel gives modes a matrix to draw on the panel with. The ring's buffer
+// can move when a frame goes out, so get a new one each frame.
+matrix panel()
+{
+    ring.Dirty();
+    return matrix(ring.Pixels(), config.pixelCount, PanelWidth, PanelHeight,
+                  PanelLayout, wireOrder);
+}
+
+// sendFrame sends the frame in the ring out through the output stage. A
+// frame that was held back while the pixels powered up goes through again
+// with counted false, so it isn't checksummed twice.
+void LAMP_HOT sendFrame(bool counted)
+{
+    const size_t size = ring.PixelsSize();
+    const bool correct = !output.identity;
+    if (correct) {
+        memcpy(modeFrame, ring.Pixels(), size);
+        applyCalibration(output, modeFrame, ring.Pixels(), BusPixels);
+        ring.Dirty();
+    }
+
+    // Pixels that have lost power lose their frame too, so as long as the
+    // rail is on, every frame goes out.
+    if (counted)
+        checksumFrame(frameMillis, ring.Pixels(), size, Serial);
+    if (railReady(ring.Pixels(), size)) {
+        energyFrame(frameMillis, ring.Pixels(), config.pixelCount + PanelPixels,
+            wireOrder);
+#ifdef VIEWER
+        viewerFrame(frameMillis, ring.Pixels(), config.pixelCount);
+#endif
+        ring.Show();
+    }
+
+    // Show() may have swapped buffers, so ask for Pixels() again.
+    if (correct)
+        memcpy(ring.Pixels(), modeFrame, size);
+}
+
+// outputFrame returns the frame in the ring as sendFrame() would send it,
+// with the calibration and brightness applied, and leaves the ring alone.
+// Offline renders checksum this, so their CRCs are of the same thing as the
+// live lamp's.
+const uint8_t* outputFrame()
+{
+    if (output.identity)
+        return ring.Pixels();
+    applyCalibration(output, ring.Pixels(), modeFrame, BusPixels);
+    return modeFrame;
+}
+
+void LAMP_HOT show()
+{
+    if (rendering)
+        return;
+
+    recorderFrame(frameMillis, ring.Pixels());
+    frameShown = true;
+    sendFrame(true);
+
+#ifdef MQTT_CONTROL
+    if (commandPending) {
+        mqttShown(commandKind, commandReceived);
+        commandPending = false;
+    }
+#endif
+}
+
+// railCheck sends a frame that's been held for the pixels to power up, once
+// they have, and cuts the rail once the output has been black long enough.
+void railCheck()
+{
+#ifdef RAIL_SWITCH
+    if (railHeld && millis() - railWokeAt >= RailPowerUpMs)
+        sendFrame(false);
+    if (railOn && outputBlack && (frameMillis - blackSince) >= RailOffDelay)
+    {
+        setRail(false);
+        railOffAt = frameMillis;
+        railGates++;
+        energyGated(frameMillis);
+    }
+#endif
+}
+
+// idle passes the time in modes that have nothing to draw. Offline, there's
+// no point waiting.
+void idle()
+{
+    if (!rendering)
+        delayMicroseconds(20000);
+}
 
 RgbwColor black(0,0,0,0);
-RgbwColor red(saturation, 0, 0, 0);
-RgbwColor green(0, saturation, 0, 0);
-RgbwColor blue(0, 0, saturation, 0);
-RgbwColor white(0, 0, 0, saturation);
+RgbwColor red(defaultSaturation, 0, 0, 0);
+RgbwColor green(0, defaultSaturation, 0, 0);
+RgbwColor blue(0, 0, defaultSaturation, 0);
+RgbwColor white(0, 0, 0, defaultSaturation);
 
 struct animState
 {
@@ -48,44 +378,114 @@ struct animState
     uint16_t pixel;
 };
 
+// Sized once the modes are, below.
+struct modeSnapshot;
+
 class animMode
 {
 public:
     virtual void setup() = 0;
     virtual void run() = 0;
     virtual void stop() = 0;
+
+    // snapshot saves everything the mode needs to carry on from this frame,
+    // and restore picks up from a snapshot in place of setup(). restore does
+    // nothing and returns false if the snapshot isn't one it can use. See
+    // snapshot.h. Each mode also has a snapshotSize, what its state takes
+    // up, for modeSnapshot to make room for.
+    virtual void snapshot(modeSnapshot& out) = 0;
+    virtual bool restore(const modeSnapshot& in) = 0;
 };
 
 class modeOff : public animMode
 {
 public:
-    void setup() override {ring.ClearTo(black); ring.Show();}
-    void run() override {delayMicroseconds(20000);}
+    void setup() override {ring.ClearTo(black); show();}
+    void run() override {idle();}
     void stop() override {}
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    static const uint16_t snapshotSize = 0;
 };
 
 class modeLight : public animMode
 {
+    // Color temperatures are in 1/256ths of a degree so transitions can move
+    // smoothly between table entries.
+    uint32_t kelvinStart;
+    uint32_t kelvinTarget;
+    uint32_t kelvin;
+    // The last config.kelvin seen, so a change can start a transition.
+    uint16_t configKelvin;
+    uint16_t kelvinDelay = 0;
+    unsigned long transitionStart;
+
+    // Dither error for each channel of each pixel. Carrying the remainder
+    // over to the next frame means fractional channel values average out
+    // over time instead of stepping.
+    uint8_t dither[PixelCount][4];
+    // Set once the ring holds an exact table color, so it needn't be redrawn
+    // until the color or the saturation changes.
+    bool settled;
+    uint8_t drawnSaturation;
+
+    struct saved
+    {
+        uint32_t kelvinStart;
+        uint32_t kelvinTarget;
+        uint32_t kelvin;
+        uint32_t transitionElapsed;
+        uint16_t configKelvin;
+        uint16_t kelvinDelay;
+        uint8_t dither[PixelCount][4];
+        // What's on the ring, which the dither has moved on from.
+        RgbwColor pixels[PixelCount];
+        uint16_t pixelCount;
+        bool settled;
+        uint8_t drawnSaturation;
+    };
+
+    bool draw();
+    void report();
 public:
-    void setup() override {ring.ClearTo(white); ring.Show();}
-    void run() override {delayMicroseconds(20000);}
+    void setup() override;
+    void run() override;
     void stop() override {}
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    // setKelvin starts a transition to a new color temperature, taking ms to
+    // get there.
+    void setKelvin(uint16_t k, uint16_t ms);
+
+    static const uint16_t snapshotSize = sizeof(saved);
 };
 
 class modeFader : public animMode
 {
-    // 15s between colors?
-    const int fadeDelay = 15000;
-    NeoPixelAnimator animations{1};
+    ddaFade fade;
     animState state[1];
     int inOrOut;
 
-    void animUpd(const AnimationParam& param);
+    struct saved
+    {
+        // The fade, with its times counted from the snapshot.
+        ddaFade fade;
+        RgbwColor startColor;
+        RgbwColor endColor;
+        int32_t inOrOut;
+    };
+
     void fadeInOut();
 public:
     void setup() override;
     void run() override;
     void stop() override;
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    static const uint16_t snapshotSize = sizeof(saved);
 };
 
 class modeRotator : public animMode
@@ -94,23 +494,42 @@ class modeRotator : public animMode
     int dot1;
     int dot2;
 
-    // Target colors for each pixel in the chain.
-    RgbwColor cols1[PixelCount / 2];
-    RgbwColor cols2[PixelCount / 2];
+    // Target colors for each pixel, going backwards from dot1: a gradient
+    // from the first color to the second, reaching it at dot2, and back.
+    gradient cols{PixelCount};
 
     // Target colors for the leading pixel.
     RgbwColor col1Start, col2Start;
     RgbwColor col1Target, col2Target;
+    // How far from the start colors to the targets cols was last baked at.
+    float switched;
 
     animState state[PixelCount];
-    NeoPixelAnimator animations{PixelCount};
-    NeoPixelAnimator switchAnim{PixelCount};
-
-    // For the rotator, delay this long before moving to the next pixel.
-    const uint16_t rotateDelay = 200;
-    // This is the amount of time it takes to completely change the two rotating
-    // colors for new ones.
-    const uint16_t switchColsDelay = 20000;
+    frameAnimator animations{PixelCount};
+    frameAnimator switchAnim{PixelCount};
+
+    struct saved
+    {
+        int32_t dot1;
+        int32_t dot2;
+        RgbwColor col1Start, col2Start;
+        RgbwColor col1Target, col2Target;
+        RgbwColor startColors[PixelCount];
+        RgbwColor endColors[PixelCount];
+        // What's on the ring. The step was drawn a frame ago, so it can't be
+        // worked out from how far the step has got now.
+        RgbwColor pixels[PixelCount];
+        float switched;
+        // How far the step and the color switch had got, in ms. A duration
+        // of 0 means it wasn't running.
+        uint32_t spinElapsed;
+        uint32_t switchElapsed;
+        uint16_t spinDuration;
+        uint16_t switchDuration;
+        uint16_t pixelCount;
+        uint16_t unused;
+    };
+
     void animUpd(const AnimationParam& param);
     void switchUpd(const AnimationParam& param);
     void spin();
@@ -122,15 +541,343 @@ public:
     void setup() override;
     void run() override;
     void stop() override;
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    static const uint16_t snapshotSize = sizeof(saved);
+};
+
+class modeComet : public animMode
+{
+    // Location of the heads of the two comets
+    int head1;
+    int head2;
+    RgbwColor col1, col2;
+
+    // The comets move one pixel every stepDelay ms.
+    const uint16_t stepDelay = 60;
+    // Each step, every pixel keeps trailKeep/256 of its brightness. This is
+    // what draws the tails; nothing else remembers where the comets have been.
+    const uint8_t trailKeep = 180;
+    unsigned long lastStep;
+
+    // The trails are only in the ring, so they're saved along with the
+    // heads.
+    struct saved
+    {
+        int32_t head1;
+        int32_t head2;
+        RgbwColor col1, col2;
+        uint32_t sinceStep;
+        uint16_t pixelCount;
+        uint16_t unused;
+        RgbwColor pixels[PixelCount];
+    };
+
+    void newColors();
+public:
+    void setup() override;
+    void run() override;
+    void stop() override;
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    static const uint16_t snapshotSize = sizeof(saved);
+};
+
+#ifdef PANEL
+class modeLife : public animMode
+{
+    life grid{PanelWidth, PanelHeight};
+    RgbwColor palette[256];
+    // Populations from the last two generations. When nothing changes from
+    // one generation to the one after next for staleLimit generations, the
+    // grid is stuck (or blinking) and gets seeded again.
+    uint32_t population[2];
+    uint8_t stale;
+    // The palette's hue, in degrees.
+    uint16_t hue;
+
+    const uint16_t stepDelay = 150;
+    const uint8_t staleLimit = 30;
+    // About one cell in four starts alive.
+    const uint8_t density = 64;
+    unsigned long lastStep;
+
+    struct saved
+    {
+        uint32_t population[2];
+        uint32_t sinceStep;
+        uint16_t hue;
+        uint8_t stale;
+        uint8_t unused;
+        uint8_t ages[PanelPixels];
+    };
+
+    void newColors();
+    void paint();
+    void reseed();
+public:
+    void setup() override;
+    void run() override;
+    void stop() override;
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    static const uint16_t snapshotSize = sizeof(saved);
+};
+#endif
+
+#ifdef SD_PLAYBACK
+class modePlayback : public animMode
+{
+    bool playing;
+    unsigned long started;
+
+    struct saved
+    {
+        // The frame of the show that was due, and how far into it.
+        uint32_t frame;
+        uint32_t into;
+    };
+public:
+    void setup() override;
+    void run() override;
+    void stop() override;
+    void snapshot(modeSnapshot& out) override;
+    bool restore(const modeSnapshot& in) override;
+
+    static const uint16_t snapshotSize = sizeof(saved);
 };
+#endif
+
+constexpr uint16_t largest(uint16_t a)
+{
+    return a;
+}
+
+template<typename... More>
+constexpr uint16_t largest(uint16_t a, uint16_t b, More... more)
+{
+    return largest(a > b ? a : b, more...);
+}
+
+// Snapshots have room for the biggest state of any mode built in. Declared
+// extern so that test/snapshot_test.cpp can make room for them too.
+extern const uint16_t SnapshotMaxData;
+const uint16_t SnapshotMaxData = largest(modeOff::snapshotSize,
+    modeLight::snapshotSize, modeFader::snapshotSize,
+    modeRotator::snapshotSize, modeComet::snapshotSize
+#ifdef PANEL
+    , modeLife::snapshotSize
+#endif
+#ifdef SD_PLAYBACK
+    , modePlayback::snapshotSize
+#endif
+    );
+
+struct modeSnapshot : snapshotOf<SnapshotMaxData> {};
+
+void modeOff::snapshot(modeSnapshot& out)
+{
+    snapshotWrite(out, nullptr, 0);
+}
+
+bool modeOff::restore(const modeSnapshot& in)
+{
+    if (!snapshotRead(in, nullptr, 0))
+        return false;
+    setup();
+    return true;
+}
 
 animMode* modes[] = {
     new modeOff{}, 
     new modeFader{}, 
     new modeRotator{}, 
-    new modeLight{}};
+    new modeLight{},
+    new modeComet{},
+#ifdef PANEL
+    new modeLife{},
+#endif
+#ifdef SD_PLAYBACK
+    new modePlayback{},
+#endif
+};
+
+// Declared extern so that test/lamp.cpp can check the modes it's asked to
+// replay against it.
+extern const size_t modeCount;
+const size_t modeCount = countof(modes);
+
+// The mode that was running last frame. -1 makes the next runMode() set its
+// mode up from scratch.
+int lastMode = -1;
+
+// Config arriving over Serial is parsed as it comes in. Once it's complete
+// it's published to configBlock, and the render loop picks it up at the
+// start of the next frame, so nothing that changes the config ever has to
+// share a lock with run(). controlConfig is the latest config published,
+// which the next change builds on.
+configParser parser;
+bool parsingConfig = false;
+// Set after a parse error, to ignore the rest of the line.
+bool skippingLine = false;
+seqlock<lampConfig> configBlock;
+lampConfig controlConfig;
+// The configBlock version the render loop last applied.
+uint32_t configVersion = 0;
+
+// buildModulation sets up the sources for the mode timings. They start with
+// no depth, so nothing moves until tuneModulation() gives them some.
+void buildModulation()
+{
+    mods.clear();
+    // Every 5s the walk takes a step of up to a fifth of its range.
+    wander = mods.addRandomWalk(5000, 0.2f, 0.0f);
+    // The swing fades in over 10s, so the rotator always starts at the speed
+    // it's set to.
+    swingIn = mods.addEnvelope(10000, 0, 1.0f, 0, 1.0f);
+    swing = mods.addLfo(lfoSine, config.swingPeriod, 0.0f, swingIn);
+}
+
+// tuneModulation picks up the depths and period in the config.
+void tuneModulation()
+{
+    mods.setDepth(wander, config.fadeWander / 100.0f);
+    mods.setDepth(swing, config.rotateSwing / 100.0f);
+    mods.setPeriod(swing, config.swingPeriod);
+}
+
+// applyConfig switches to a new config. Everything reads the config as it
+// goes, so this happens between frames; only a change in the number of
+// pixels restarts the current mode.
+void applyConfig(const lampConfig& next)
+{
+    bool resize = next.pixelCount != config.pixelCount;
+    config = next;
+    if(config.pixelCount == 0 || config.pixelCount > PixelCount)
+        config.pixelCount = PixelCount;
+
+    setBrightness(outputBrightness);
+    tuneModulation();
+    hues.setLuminance(config.luminance);
+    if(resize)
+    {
+        ring.ClearTo(black);
+        lastMode = -1;
+    }
+}
+
+#ifdef ENCODER
+// scaleDelay returns ms scaled, kept to something the config can hold.
+uint16_t scaleDelay(uint16_t ms, float scale)
+{
+    float scaled = ms * scale;
+    if(scaled < 1.0f)
+        return 1;
+    if(scaled > 65535.0f)
+        return 65535;
+    return uint16_t(scaled);
+}
+
+// encoderFrame applies any turn of the knob since the last frame.
+void encoderFrame()
+{
+    int16_t detents = encoderTake();
+    if(detents == 0)
+        return;
+
+    if(config.encoderSpeed)
+    {
+        // Clockwise is faster, so the delays get shorter. This goes out
+        // like any other config change, so it's in place from next frame.
+        float scale = powf(EncoderSpeedStep, detents);
+        lampConfig next = controlConfig;
+        next.fadeDelay = scaleDelay(next.fadeDelay, scale);
+        next.rotateDelay = scaleDelay(next.rotateDelay, scale);
+        next.switchColsDelay = scaleDelay(next.switchColsDelay, scale);
+        controlConfig = next;
+        configBlock.publish(next);
+    }
+    else
+    {
+        int level = outputBrightness + detents * EncoderBrightnessStep;
+        setBrightness(level < 0 ? 0 : level > 255 ? 255 : level);
+        // Modes only show frames when they change something.
+        show();
+    }
+}
+#endif
+
+// loadConfig applies the config saved in flash, if there is one.
+void loadConfig()
+{
+    Preferences prefs;
+    if(!prefs.begin("lamp", true))
+        return;
+
+    char saved[256];
+    size_t len = prefs.getString("config", saved, sizeof(saved));
+    prefs.end();
+    if(len == 0)
+        return;
+
+    parser.begin(config);
+    configStatus status = configMore;
+    for(size_t i = 0; i < len && saved[i] && status == configMore; i++)
+        status = parser.feed(saved[i]);
+
+    if(status == configDone)
+    {
+        applyConfig(parser.result());
+        controlConfig = config;
+    }
+    else
+        Serial.printf("saved config: %s\n",
+            status == configError ? parser.error() : "incomplete");
+}
+
+void saveConfig()
+{
+    char buf[256];
+    formatConfig(config, buf, sizeof(buf));
+
+    Preferences prefs;
+    if(prefs.begin("lamp", false))
+    {
+        prefs.putString("config", buf);
+        prefs.end();
+    }
+}
 
-const auto modeCount = countof(modes);
+void printConfig()
+{
+    char buf[256];
+    formatConfig(config, buf, sizeof(buf));
+    Serial.println(buf);
+}
+
+// configChar feeds c to the config parser.
+void configChar(char c)
+{
+    configStatus status = parser.feed(c);
+    if(status == configMore)
+        return;
+
+    parsingConfig = false;
+    if(status == configDone)
+    {
+        controlConfig = parser.result();
+        configBlock.publish(controlConfig);
+        Serial.println("config ok");
+    }
+    else
+    {
+        Serial.printf("config error: %s\n", parser.error());
+        skippingLine = c != '\n';
+    }
+}
 
 void setup()
 {
@@ -141,7 +888,66 @@ void setup()
     Serial.println("\nInitializing...");
     Serial.flush();
 
+    // If we got here by crashing, show what the lamp was doing beforehand.
+    if (recorderBegin(ring.PixelsSize()) &&
+        rtc_get_reset_reason(0) != POWERON_RESET)
+    {
+        Serial.println("Recording from before the reset:");
+        recorderDump(Serial);
+    }
+    if(!recorderRecording())
+        Serial.printf("Not recording: no room for %u byte frames\n",
+                      unsigned(ring.PixelsSize()));
+
     pinMode(SwitchPin, INPUT);
+#ifdef RAIL_SWITCH
+    pinMode(RailPin, OUTPUT);
+    setRail(true);
+#endif
+
+    // Only the ring has saved gains; the panel is left as it is.
+    memset(pixelGains, 255, sizeof(pixelGains));
+    resetCalibration(calibration, pixelGains);
+    loadCalibration(calibration, wireOrder, PixelCount);
+    rngSeed(esp_random());
+    buildModulation();
+    hues.begin();
+    controlConfig = config;
+    configPixelLimit(PixelCount);
+    loadConfig();
+    tuneModulation();
+    hues.setLuminance(config.luminance);
+    // Start the block off with the config in use, for anything that builds
+    // on it from another task.
+    configBlock.publish(config);
+    setBrightness(outputBrightness);
+    energyBegin(millis(), BusPixels);
+
+#ifdef AMBIENT_SENSOR
+    ambientBegin(LightChannel);
+#endif
+
+#ifdef ENCODER
+    encoderBegin(EncoderPinA, EncoderPinB);
+#endif
+
+#ifdef SD_PLAYBACK
+    if (!playbackMount(SdCsPin))
+        Serial.println("playback: no SD card");
+#endif
+
+#ifdef MQTT_CONTROL
+    mqttBegin(&configBlock, modeCount);
+#endif
+
+#ifdef VIEWER
+    if (!viewerBegin(VIEWER_NAME, ring.PixelsSize(), PanelWidth, PanelHeight))
+        Serial.println("viewer: no shared memory");
+#endif
+
+#ifdef BENCHMARK
+    runBenchmarks();
+#endif
 
     // turn all pixels off
     ring.Begin();
@@ -152,22 +958,38 @@ void setup()
 
 int prevPix(int pix)
 {
-    return (pix + PixelCount - 1) % PixelCount;
+    return (pix + config.pixelCount - 1) % config.pixelCount;
 }
 
 int nextPix(int pix)
 {
-    return (pix + 1) % PixelCount;
+    return (pix + 1) % config.pixelCount;
+}
+
+// fadeTrails dims everything already in the ring by keep/256. A mode that
+// calls it once per frame before drawing gets trails behind anything that
+// moves, for the cost of a multiply and a shift per byte. It works on the raw
+// pixel buffer, so the channel order doesn't matter.
+void LAMP_HOT fadeTrails(uint8_t keep)
+{
+    uint8_t* p = ring.Pixels();
+    const size_t size = ring.PixelsSize();
+
+    for (size_t i = 0; i < size; i++)
+        p[i] = (p[i] * keep) >> 8;
+
+    ring.Dirty();
 }
 
 //
 // modeRotator:
 //
-void modeRotator::animUpd(const AnimationParam& param)
+void LAMP_HOT modeRotator::animUpd(const AnimationParam& param)
 {
     auto progress = param.progress;
 
-    for (auto& s : state) {
+    for (int pix = 0; pix < config.pixelCount; pix++) {
+        auto& s = state[pix];
         // Serial.printf("pixel %d, sc %d %d %d, ec %d, %d, %d\n",
         //     s.pixel, s.StartColor.R, s.StartColor.G, s.StartColor.B, 
         //     s.EndColor.R, s.EndColor.G, s.EndColor.B);
@@ -190,25 +1012,18 @@ void modeRotator::spin()
     dot1 = nextPix(dot1);
     dot2 = nextPix(dot2);
 
-    // rotate the target color to the next pixel. All other dots should fade to
-    // black.
+    // rotate the target colors one pixel along.
     auto p = dot1;
-    for (auto col : cols1) {
+    for (int c = 0; c < config.pixelCount; c++) {
         auto& s = state[p];
         s.StartColor = s.EndColor;
-        s.EndColor = col;
-        p = prevPix(p);
-    }
-    p = dot2;
-    for (auto col : cols2) {
-        auto& s = state[p];
-        s.StartColor = s.EndColor;
-        s.EndColor = col;
+        s.EndColor = cols.sample(c);
         p = prevPix(p);
     }
 
     auto updfn = [this](const AnimationParam& p) { animUpd(p); };
-    animations.StartAnimation(0, rotateDelay, updfn);
+    animations.StartAnimation(0,
+        mods.modulate(config.rotateDelay, swing, frameMillis), updfn);
 }
 
 void modeRotator::switchCol()
@@ -216,16 +1031,20 @@ void modeRotator::switchCol()
     newColors();
 
     auto updfn = [this](const AnimationParam& p) { switchUpd(p); };
-    switchAnim.StartAnimation(0, switchColsDelay, updfn);
+    switchAnim.StartAnimation(0,
+        mods.modulate(config.switchColsDelay, wander, frameMillis), updfn);
 }
 
 void modeRotator::setup()
 {
     ring.ClearTo(black);
-    ring.Show();
+    show();
+    mods.trigger(swingIn, frameMillis);
 
     dot1 = 0;
-    dot2 = PixelCount / 2;
+    dot2 = config.pixelCount / 2;
+    cols.setSize(config.pixelCount);
+    cols.setWrap(true);
 
     int pix = 0;
     for (auto& pixState : state) {
@@ -234,6 +1053,13 @@ void modeRotator::setup()
         pixState.EndColor = black;
     }
 
+    // Start from black rather than from wherever the last run left off, so
+    // a render of the rotator draws the same frames whatever came before it.
+    col1Target = black;
+    col2Target = black;
+    animations.StopAll();
+    switchAnim.StopAll();
+
     // pick the colors and setup the targets for each pixel.
     newColors();
 }
@@ -245,8 +1071,8 @@ void modeRotator::newColors()
     col2Start = col2Target;
 
     // pick two random colors to chase each other.
-    col1Target = HslColor(random(360) / 360.0f, 1.0f, luminance);
-    col2Target = HslColor(random(360) / 360.0f, 1.0f, luminance);
+    col1Target = hues.nextColor();
+    col2Target = hues.nextColor();
 
     calcCols(0.0);
 
@@ -254,27 +1080,27 @@ void modeRotator::newColors()
     // state[dot2].EndColor = col2Target;
 }
 
-void modeRotator::calcCols(float progress)
+void LAMP_HOT modeRotator::calcCols(float progress)
 {
+    switched = progress;
     auto col1 = RgbwColor::LinearBlend(col1Start, col1Target, progress);
     auto col2 = RgbwColor::LinearBlend(col2Start, col2Target, progress);
 
-    // We have the target colors for the two leading pixels. Now calculate the
-    // target colors for the rest of the pixels in the 2 chains.
-    for (int c = 0; c < PixelCount / 2; c++)
-    {
-        float blend = float(c) / float(PixelCount / 2);
-        cols1[c] = RgbwColor::LinearBlend(col1, col2, blend);
-        cols2[c] = RgbwColor::LinearBlend(col2, col1, blend);
-    }
+    // We have the target colors for the two leading pixels. The rest of the
+    // pixels in the 2 chains blend between them. Most frames the blend hasn't
+    // moved far enough to change either color, and the gradient doesn't need
+    // rebaking.
+    cols.setStop(0, 0, col1);
+    cols.setStop(1, 32768, col2);
+    cols.bake();
 }
 
-void modeRotator::run()
+void LAMP_HOT modeRotator::run()
 {
     if(animations.IsAnimating())
     {
         animations.UpdateAnimations();
-        ring.Show();
+        show();
     }
     else
     {
@@ -296,27 +1122,81 @@ void modeRotator::run()
 void modeRotator::stop()
 {
     animations.StopAll();
+    switchAnim.StopAll();
 }
 
-//
-// modeFader
-//
-void modeFader::animUpd(const AnimationParam& param)
+void modeRotator::snapshot(modeSnapshot& out)
 {
-    auto progress = param.progress;
-    //auto progress = NeoEase::QuadraticInOut(param.progress);
-    RgbwColor col = RgbwColor::LinearBlend(
-        state[0].StartColor,
-        state[0].EndColor,
-        progress);
-
-    //col = cgamma.Correct(col);
-    for(uint16_t pixel = 0; pixel < PixelCount; pixel++)
-    {
-        ring.SetPixelColor(pixel, col);
+    saved s = {};
+    s.dot1 = dot1;
+    s.dot2 = dot2;
+    s.col1Start = col1Start;
+    s.col2Start = col2Start;
+    s.col1Target = col1Target;
+    s.col2Target = col2Target;
+    for (int pix = 0; pix < PixelCount; pix++) {
+        s.startColors[pix] = state[pix].StartColor;
+        s.endColors[pix] = state[pix].EndColor;
+    }
+    for (int pix = 0; pix < config.pixelCount; pix++)
+        s.pixels[pix] = ring.GetPixelColor(pix);
+    s.switched = switched;
+    if (animations.IsActive(0)) {
+        s.spinElapsed = animations.Elapsed(0);
+        s.spinDuration = animations.Duration(0);
+    }
+    if (switchAnim.IsActive(0)) {
+        s.switchElapsed = switchAnim.Elapsed(0);
+        s.switchDuration = switchAnim.Duration(0);
+    }
+    s.pixelCount = config.pixelCount;
+    snapshotPut(out, s);
+}
+
+bool modeRotator::restore(const modeSnapshot& in)
+{
+    saved s;
+    if (!snapshotGet(in, s) || s.pixelCount != config.pixelCount)
+        return false;
+
+    dot1 = s.dot1;
+    dot2 = s.dot2;
+    col1Start = s.col1Start;
+    col2Start = s.col2Start;
+    col1Target = s.col1Target;
+    col2Target = s.col2Target;
+    for (int pix = 0; pix < PixelCount; pix++) {
+        state[pix].pixel = pix;
+        state[pix].StartColor = s.startColors[pix];
+        state[pix].EndColor = s.endColors[pix];
+    }
+    cols.setSize(config.pixelCount);
+    cols.setWrap(true);
+
+    animations.StopAll();
+    switchAnim.StopAll();
+    if (s.switchDuration) {
+        auto updfn = [this](const AnimationParam& p) { switchUpd(p); };
+        switchAnim.ResumeAnimation(0, s.switchDuration, s.switchElapsed,
+            updfn);
     }
+    if (s.spinDuration) {
+        auto updfn = [this](const AnimationParam& p) { animUpd(p); };
+        animations.ResumeAnimation(0, s.spinDuration, s.spinElapsed, updfn);
+    }
+    // The gradient as it was last baked, which the next step samples.
+    calcCols(s.switched);
+
+    ring.ClearTo(black);
+    for (int pix = 0; pix < config.pixelCount; pix++)
+        ring.SetPixelColor(pix, s.pixels[pix]);
+    show();
+    return true;
 }
 
+//
+// modeFader
+//
 void modeFader::fadeInOut()
 {
     // For fade out, target color is black.
@@ -325,15 +1205,14 @@ void modeFader::fadeInOut()
     if(inOrOut == 0)
     {
         // Fade to a random color
-        col = HslColor(random(360) / 360.0f, 1.0f, luminance);
+        col = hues.nextColor();
     }
 
     state[0].StartColor = state[0].EndColor;
     state[0].EndColor = col;
 
-    // Use a member function for animation callbacks.
-    auto updfn = [this](const AnimationParam& p) { animUpd(p); };
-    animations.StartAnimation(0, fadeDelay, updfn);
+    fade.start(state[0].StartColor, state[0].EndColor, frameMillis,
+        mods.modulate(config.fadeDelay, wander, frameMillis));
 
     // flip the state. (Commented out so that it fades from color to color)
     //inOrOut ^= 1;
@@ -344,43 +1223,496 @@ void modeFader::setup()
     inOrOut = 0;
     state[0].StartColor = black;
     state[0].EndColor = black;
+    fade.start(black, black, frameMillis, 0);
     ring.ClearTo(black);
-    ring.Show();
+    show();
 }
 
-void modeFader::run()
+void LAMP_HOT modeFader::run()
 {
-    if(animations.IsAnimating())
-    {
-        animations.UpdateAnimations();
-        ring.Show();
-    } 
-    else
+    if(fade.done())
     {
         // Start an animation
         fadeInOut();
     }
+    else if(fade.update(frameMillis))
+    {
+        // Over 15s most frames don't change a single byte, so only redraw
+        // when the fade has actually moved.
+        RgbwColor col = fade.color();
+        //col = cgamma.Correct(col);
+        ring.ClearTo(col, 0, config.pixelCount - 1);
+        show();
+    }
 }
 
 void modeFader::stop()
 {
-    animations.StopAll();
 }
 
-void runMode(int mode)
+void modeFader::snapshot(modeSnapshot& out)
+{
+    saved s = {};
+    s.fade = fade;
+    s.fade.rebase(frameMillis, 0);
+    s.startColor = state[0].StartColor;
+    s.endColor = state[0].EndColor;
+    s.inOrOut = inOrOut;
+    snapshotPut(out, s);
+}
+
+bool modeFader::restore(const modeSnapshot& in)
+{
+    saved s;
+    if (!snapshotGet(in, s))
+        return false;
+
+    fade = s.fade;
+    fade.rebase(0, frameMillis);
+    state[0].StartColor = s.startColor;
+    state[0].EndColor = s.endColor;
+    inOrOut = s.inOrOut;
+
+    // run() only draws when the fade moves, so put it up now.
+    ring.ClearTo(black);
+    ring.ClearTo(fade.color(), 0, config.pixelCount - 1);
+    show();
+    return true;
+}
+
+//
+// modeComet
+//
+void modeComet::newColors()
+{
+    col1 = hues.nextColor();
+    col2 = hues.nextColor();
+}
+
+void modeComet::setup()
+{
+    ring.ClearTo(black);
+    show();
+
+    head1 = 0;
+    head2 = config.pixelCount / 2;
+    lastStep = frameMillis;
+    newColors();
+}
+
+void LAMP_HOT modeComet::run()
+{
+    if ((frameMillis - lastStep) < stepDelay)
+        return;
+    lastStep = frameMillis;
+
+    head1 = nextPix(head1);
+    head2 = nextPix(head2);
+    // pick new colors each time around the ring.
+    if (head1 == 0)
+        newColors();
+
+    fadeTrails(trailKeep);
+    ring.SetPixelColor(head1, col1);
+    ring.SetPixelColor(head2, col2);
+    show();
+}
+
+void modeComet::stop()
+{
+}
+
+void modeComet::snapshot(modeSnapshot& out)
+{
+    saved s = {};
+    s.head1 = head1;
+    s.head2 = head2;
+    s.col1 = col1;
+    s.col2 = col2;
+    s.sinceStep = frameMillis - lastStep;
+    s.pixelCount = config.pixelCount;
+    for (int pix = 0; pix < config.pixelCount; pix++)
+        s.pixels[pix] = ring.GetPixelColor(pix);
+    snapshotPut(out, s);
+}
+
+bool modeComet::restore(const modeSnapshot& in)
+{
+    saved s;
+    if (!snapshotGet(in, s) || s.pixelCount != config.pixelCount)
+        return false;
+
+    head1 = s.head1;
+    head2 = s.head2;
+    col1 = s.col1;
+    col2 = s.col2;
+    lastStep = frameMillis - s.sinceStep;
+
+    ring.ClearTo(black);
+    for (int pix = 0; pix < config.pixelCount; pix++)
+        ring.SetPixelColor(pix, s.pixels[pix]);
+    show();
+    return true;
+}
+
+#ifdef PANEL
+//
+// modeLife
+//
+// newColors builds the palette for the cell ages in life.h: the dead glow
+// fades down to black, and cells drift a third of the way round the color
+// wheel as they get older.
+void modeLife::newColors()
+{
+    hue = hues.nextHue();
+    paint();
+}
+
+// paint fills in the palette for the current hue.
+void modeLife::paint()
+{
+    float base = hue / 360.0f;
+    palette[0] = black;
+    for (int i = 1; i < 128; i++) {
+        float glow = i < LifeGlow ? float(i) / LifeGlow : 1.0f;
+        palette[i] = HslColor(base, 1.0f, config.luminance * glow * 0.5f);
+    }
+    for (int i = 128; i < 256; i++) {
+        float h = base + (i - 128) / (3.0f * 127);
+        if (h >= 1.0f)
+            h -= 1.0f;
+        palette[i] = HslColor(h, 1.0f, config.luminance);
+    }
+}
+
+void modeLife::reseed()
+{
+    grid.seed(density);
+    newColors();
+    population[0] = population[1] = 0;
+    stale = 0;
+}
+
+void modeLife::setup()
+{
+    ring.ClearTo(black);
+    reseed();
+    panel().blit(grid.image(palette), 0, 0);
+    show();
+    lastStep = frameMillis;
+}
+
+void LAMP_HOT modeLife::run()
+{
+    if ((frameMillis - lastStep) < stepDelay)
+        return;
+    lastStep = frameMillis;
+
+    uint32_t alive = grid.step();
+    if (alive == population[1])
+        stale++;
+    else
+        stale = 0;
+    population[1] = population[0];
+    population[0] = alive;
+    if (alive == 0 || stale >= staleLimit)
+        reseed();
+
+    panel().blit(grid.image(palette), 0, 0);
+    show();
+}
+
+void modeLife::stop()
 {
-    static int lastMode = -1;
+}
 
+void modeLife::snapshot(modeSnapshot& out)
+{
+    saved s = {};
+    s.population[0] = population[0];
+    s.population[1] = population[1];
+    s.sinceStep = frameMillis - lastStep;
+    s.hue = hue;
+    s.stale = stale;
+    grid.saveAges(s.ages);
+    snapshotPut(out, s);
+}
+
+bool modeLife::restore(const modeSnapshot& in)
+{
+    saved s;
+    if (!snapshotGet(in, s))
+        return false;
+
+    population[0] = s.population[0];
+    population[1] = s.population[1];
+    lastStep = frameMillis - s.sinceStep;
+    hue = s.hue;
+    stale = s.stale;
+    grid.loadAges(s.ages);
+    paint();
+
+    ring.ClearTo(black);
+    panel().blit(grid.image(palette), 0, 0);
+    show();
+    return true;
+}
+#endif
+
+#ifdef SD_PLAYBACK
+//
+// modePlayback
+//
+void modePlayback::setup()
+{
+    ring.ClearTo(black);
+    show();
+    playing = playbackOpen(ShowPath, ring.PixelsSize());
+    if (!playing)
+        Serial.printf("playback: can't play %s\n", ShowPath);
+    started = frameMillis;
+}
+
+void LAMP_HOT modePlayback::run()
+{
+    if (!playing) {
+        idle();
+        return;
+    }
+
+    // The show keeps time with the frame clock, whatever the card does.
+    uint32_t due = (frameMillis - started) / playbackFrameMs();
+    if (playbackFrame(due, ring.Pixels())) {
+        ring.Dirty();
+        show();
+    }
+}
+
+void modePlayback::stop()
+{
+    playbackClose();
+}
+
+void modePlayback::snapshot(modeSnapshot& out)
+{
+    saved s = {};
+    if (playing) {
+        uint32_t elapsed = frameMillis - started;
+        s.frame = elapsed / playbackFrameMs();
+        s.into = elapsed % playbackFrameMs();
+    }
+    snapshotPut(out, s);
+}
+
+bool modePlayback::restore(const modeSnapshot& in)
+{
+    saved s;
+    if (!snapshotGet(in, s))
+        return false;
+
+    // The show is opened at the frame that was due, rather than read through
+    // from the start to get there.
+    ring.ClearTo(black);
+    show();
+    playing = playbackOpen(ShowPath, ring.PixelsSize(), s.frame);
+    if (!playing)
+        Serial.printf("playback: can't play %s\n", ShowPath);
+    started = frameMillis;
+    if (playing)
+        started -= s.frame * playbackFrameMs() + s.into;
+    return true;
+}
+#endif
+
+//
+// modeLight
+//
+void modeLight::setKelvin(uint16_t k, uint16_t ms)
+{
+    if (k < WhiteMinKelvin)
+        k = WhiteMinKelvin;
+    if (k > WhiteMaxKelvin)
+        k = WhiteMaxKelvin;
+
+    kelvinStart = kelvin;
+    kelvinTarget = uint32_t(k) << 8;
+    kelvinDelay = ms;
+    transitionStart = frameMillis;
+}
+
+// draw puts the current color temperature on the ring. It returns false if
+// the ring is showing exactly that color already and doesn't need redrawing.
+bool LAMP_HOT modeLight::draw()
+{
+    // Find where we are in the table, in 1/256ths of an entry.
+    uint32_t pos = (kelvin - (uint32_t(WhiteMinKelvin) << 8)) / WhiteStepKelvin;
+    uint32_t idx = pos >> 8;
+    uint32_t frac = pos & 0xff;
+    const uint8_t* lo = whiteTable[idx];
+    const uint8_t* hi = frac ? whiteTable[idx + 1] : lo;
+
+    // Channel values in 8.8 fixed point, scaled to the output level.
+    uint16_t level[4];
+    bool exact = true;
+    for (int c = 0; c < 4; c++) {
+        uint32_t v = (lo[c] << 8) + (hi[c] - lo[c]) * int32_t(frac);
+        level[c] = v * config.saturation / 255;
+        exact = exact && (level[c] & 0xff) == 0;
+    }
+
+    if (exact && settled && drawnSaturation == config.saturation)
+        return false;
+    settled = exact;
+    drawnSaturation = config.saturation;
+
+    for (int pix = 0; pix < config.pixelCount; pix++) {
+        uint8_t out[4];
+        for (int c = 0; c < 4; c++) {
+            uint16_t sum = dither[pix][c] + (level[c] & 0xff);
+            out[c] = (level[c] >> 8) + (sum >> 8);
+            dither[pix][c] = sum;
+        }
+        ring.SetPixelColor(pix, RgbwColor(out[0], out[1], out[2], out[3]));
+    }
+    return true;
+}
+
+void modeLight::setup()
+{
+    configKelvin = config.kelvin;
+    setKelvin(configKelvin, 0);
+    kelvin = kelvinTarget;
+    settled = false;
+
+    // Spread the starting dither error around the ring so the pixels don't
+    // all step on the same frame.
+    for (int pix = 0; pix < PixelCount; pix++)
+        for (int c = 0; c < 4; c++)
+            dither[pix][c] = pix * 256 / PixelCount;
+
+    draw();
+    show();
+
+    report();
+}
+
+// report prints the color and what it's estimated to draw, for whoever is
+// tuning the lamp at the serial console. Offline renders send their frames
+// down the same port, so nothing is printed while one is running.
+void modeLight::report()
+{
+    if (rendering)
+        return;
+    auto col = ring.GetPixelColor(0);
+    Serial.printf("white %uK: R%d G%d B%d W%d, about %umA\n",
+        unsigned(kelvin >> 8), col.R, col.G, col.B, col.W,
+        unsigned(estimateMilliamps(col) * config.pixelCount));
+}
+
+void LAMP_HOT modeLight::run()
+{
+    if (config.kelvin != configKelvin) {
+        configKelvin = config.kelvin;
+        setKelvin(configKelvin, 2000);
+    }
+
+    bool arrived = false;
+    if (kelvin != kelvinTarget) {
+        uint32_t elapsed = frameMillis - transitionStart;
+        if (elapsed >= kelvinDelay) {
+            kelvin = kelvinTarget;
+        } else {
+            int32_t span = int32_t(kelvinTarget) - int32_t(kelvinStart);
+            kelvin = kelvinStart + int64_t(span) * int64_t(elapsed) / kelvinDelay;
+        }
+        arrived = kelvin == kelvinTarget;
+    }
+
+    if (draw())
+        show();
+    else
+        idle();
+
+    if (arrived)
+        report();
+}
+
+void modeLight::snapshot(modeSnapshot& out)
+{
+    saved s = {};
+    s.kelvinStart = kelvinStart;
+    s.kelvinTarget = kelvinTarget;
+    s.kelvin = kelvin;
+    s.transitionElapsed = frameMillis - transitionStart;
+    s.configKelvin = configKelvin;
+    s.kelvinDelay = kelvinDelay;
+    memcpy(s.dither, dither, sizeof(dither));
+    s.pixelCount = config.pixelCount;
+    for (int pix = 0; pix < config.pixelCount; pix++)
+        s.pixels[pix] = ring.GetPixelColor(pix);
+    s.settled = settled;
+    s.drawnSaturation = drawnSaturation;
+    snapshotPut(out, s);
+}
+
+bool modeLight::restore(const modeSnapshot& in)
+{
+    saved s;
+    if (!snapshotGet(in, s) || s.pixelCount != config.pixelCount)
+        return false;
+
+    kelvinStart = s.kelvinStart;
+    kelvinTarget = s.kelvinTarget;
+    kelvin = s.kelvin;
+    transitionStart = frameMillis - s.transitionElapsed;
+    configKelvin = s.configKelvin;
+    kelvinDelay = s.kelvinDelay;
+    memcpy(dither, s.dither, sizeof(dither));
+    settled = s.settled;
+    drawnSaturation = s.drawnSaturation;
+
+    // Drawing would move the dither on, so put back what was on the ring
+    // instead.
+    ring.ClearTo(black);
+    for (int pix = 0; pix < config.pixelCount; pix++)
+        ring.SetPixelColor(pix, s.pixels[pix]);
+    show();
+    return true;
+}
+
+void runMode(int mode)
+{
+    // Before setup(), so the frame it shows is recorded as the new mode's.
+    recorderMode(mode);
     if(mode != lastMode)
     {
-        modes[mode]->stop();
+        // The new mode will probably light something, and the pixels can
+        // power up during the pause.
+        railWake();
+        if(lastMode >= 0)
+            modes[lastMode]->stop();
         vTaskDelay(20);
         modes[mode]->setup();
     }
 
     lastMode = mode;
 
+    energyMode(mode, frameMillis);
+    frameShown = false;
+    uint32_t start = micros();
     modes[mode]->run();
+    if(frameShown)
+        frameTimeSample(frameMillis, micros() - start, Serial);
+    railCheck();
+}
+
+// stopMode stops whatever mode was running, so the next runMode() sets its
+// mode up from scratch.
+void stopMode()
+{
+    if(lastMode >= 0)
+        modes[lastMode]->stop();
+    lastMode = -1;
 }
 
 int switchMode(int mode)
@@ -399,7 +1731,10 @@ int switchMode(int mode)
 
         // switch was pressed, now is released. Increment the mode.
         if(val == 0)
+        {
             mode = (mode + 1) % modeCount;
+            recorderEvent(RecorderEventSwitch);
+        }
 
         // store the time for debouncing
         lastChange = millis();
@@ -408,6 +1743,242 @@ int switchMode(int mode)
     return mode;
 }
 
+// renderOffline runs a mode for duration ms of frame time from from, in
+// steps of step ms, as fast as it can, and sends every frame'th frame over
+// Serial. The lamp freezes while it works. tools/render.py turns the result
+// into pictures.
+//
+// Random numbers come from seed, and the modulation and the hues start over,
+// so a render with the same config, mode, seed and clock draws exactly the
+// same frames every time; tools/golden.py relies on that.
+//
+// The mode is set up afresh at from, with seed moved on by from, so a long
+// render can be split up and the pieces run side by side; tools/render.py
+// does that on the host. Each piece is the mode as it looks when started
+// at that point on the clock, so a piece doesn't carry on from the one
+// before the way a single render would.
+//
+// With checksums on, the frames' CRCs go out a second at a time instead of
+// the frames themselves; see checksum.h.
+void renderOffline(int mode, uint32_t duration, uint16_t step, uint16_t every,
+                   uint32_t seed, uint32_t from)
+{
+    if(mode < 0 || mode >= int(modeCount) || step == 0 || every == 0)
+    {
+        Serial.println("render: bad arguments");
+        return;
+    }
+
+    uint32_t frames = (duration / step + every - 1) / every;
+    Serial.printf(
+        "render begin mode=%d frames=%u framebytes=%u step=%u seed=%u "
+        "from=%u\n", mode, unsigned(frames), unsigned(ring.PixelsSize()),
+        unsigned(step) * every, unsigned(seed), unsigned(from));
+
+    stopMode();
+
+    rendering = true;
+    frameMillis = from;
+    rngSeed(seed + from);
+    buildModulation();
+    tuneModulation();
+    hues.begin();
+    unsigned long start = millis();
+    unsigned long lastYield = start;
+    // The CRC of everything sent, to check against the frames received.
+    uint32_t crc = 0;
+    const bool checksums = checksumEnabled();
+    checksumEnable(checksums);
+
+    modes[mode]->setup();
+    for(uint32_t f = 0; f < frames * every; f++)
+    {
+        frameMillis = from + f * step;
+        modes[mode]->run();
+        // Whatever is in the ring is what the lamp would be showing, whether
+        // or not run() drew anything new this frame.
+        if(f % every == 0)
+        {
+            if(checksums)
+                checksumFrame(frameMillis, outputFrame(), ring.PixelsSize(),
+                    Serial);
+            else
+                Serial.write(ring.Pixels(), ring.PixelsSize());
+            crc = frameCrc(crc, ring.Pixels(), ring.PixelsSize());
+        }
+
+        // keep the watchdog quiet on long renders.
+        if(millis() - lastYield > 100)
+        {
+            vTaskDelay(1);
+            lastYield = millis();
+        }
+    }
+    modes[mode]->stop();
+    rendering = false;
+    if(checksums)
+    {
+        checksumFlush(Serial);
+        // The live lamp's seconds start over.
+        checksumEnable(true);
+    }
+
+    Serial.printf("render end %lums crc=%08x\n", millis() - start,
+        unsigned(crc));
+
+    // Start whatever was running over again, and stop repeating the render's
+    // random numbers.
+    rngSeed(esp_random());
+    hues.begin();
+    frameMillis = millis();
+    lastMode = -1;
+}
+
+// snapshotMode saves where mode has got to.
+void snapshotMode(int mode, modeSnapshot& out)
+{
+    modes[mode]->snapshot(out);
+    out.mode = mode;
+}
+
+// restoreMode carries on with the mode in a snapshot from where it was, in
+// place of whatever was running, and returns that mode for the loop to run.
+// If the snapshot can't be used it returns -1, and the mode that was running
+// starts over.
+int restoreMode(const modeSnapshot& in)
+{
+    stopMode();
+    if(in.mode >= modeCount)
+        return -1;
+
+    railWake();
+    if(!modes[in.mode]->restore(in))
+        return -1;
+    lastMode = in.mode;
+    return lastMode;
+}
+
+// checkSerial handles single letter commands from the serial port:
+//   {...}  change the config, see config.h
+//   p  print the config
+//   s  save the config to flash
+//   d  dump the flight recorder
+//   e  print the energy used so far
+//   v  print what the viewer output costs, in VIEWER builds
+//   c  turn frame checksums on or off, see checksum.h
+//   u  print playback underruns, in SD_PLAYBACK builds
+//   t <seconds> <stress>
+//      measure frame times, see frametime.h
+//   r <mode> <seconds> <step ms> <every> <seed> <from seconds>
+//      render a mode offline, see renderOffline
+void checkSerial()
+{
+    while(Serial.available())
+    {
+        int c = Serial.read();
+        recorderEvent(RecorderEventSerial);
+
+        if(skippingLine)
+        {
+            skippingLine = c != '\n';
+            continue;
+        }
+        if(parsingConfig)
+        {
+            configChar(c);
+            continue;
+        }
+
+        switch(c)
+        {
+        case '{':
+            parser.begin(controlConfig);
+            parsingConfig = true;
+            configChar(c);
+            break;
+        case 'p':
+            printConfig();
+            break;
+        case 's':
+            saveConfig();
+            break;
+        case 'd':
+            recorderDump(Serial);
+            break;
+        case 'e':
+            energyReport(Serial, frameMillis);
+            railReport(Serial);
+            break;
+#ifdef VIEWER
+        case 'v':
+            viewerReport(Serial);
+            break;
+#endif
+        case 'c':
+            checksumEnable(!checksumEnabled());
+            break;
+#ifdef SD_PLAYBACK
+        case 'u':
+            playbackReport(Serial);
+            break;
+#endif
+        case 't':
+        {
+            long seconds = Serial.parseInt();
+            int stress = Serial.parseInt();
+            frameTimeBegin(frameMillis, seconds, stress != 0);
+            break;
+        }
+        case 'r':
+        {
+            int mode = Serial.parseInt();
+            long seconds = Serial.parseInt();
+            int step = Serial.parseInt();
+            int every = Serial.parseInt();
+            long seed = Serial.parseInt();
+            long from = Serial.parseInt();
+            renderOffline(mode, seconds * 1000, step, every, seed,
+                from * 1000);
+            break;
+        }
+        }
+    }
+}
+
+// handleCommands applies the commands that have come in over MQTT since the
+// last frame, and returns the mode to run.
+int handleCommands(int mode)
+{
+#ifdef MQTT_CONTROL
+    lampCommand cmd;
+    while(mqttCommands.pop(cmd))
+    {
+        commandPending = true;
+        commandKind = cmd.type;
+        commandReceived = cmd.received;
+        switch(cmd.type)
+        {
+        case commandMode:
+            // The MQTT task checks the range, but a mode that isn't there
+            // is never run.
+            if(cmd.value < modeCount)
+                mode = cmd.value;
+            break;
+        case commandBrightness:
+            setBrightness(cmd.value > 255 ? 255 : cmd.value);
+            show();
+            break;
+        case commandScene:
+            // The scene itself is in configBlock already, and is applied
+            // below.
+            break;
+        }
+    }
+    mqttState(mode, outputBrightness, energyMilliamps());
+#endif
+    return mode;
+}
+
 extern "C" void app_main() 
 {
     // This is the current animation mode. Mode0 is off.
@@ -419,9 +1990,35 @@ extern "C" void app_main()
     {
         // this keeps the watchdog from barking.
         vTaskDelay(1);
+        frameMillis = millis();
 
         // check whether the switch has been pressed.
         mode = switchMode(mode);
+        checkSerial();
+        mode = handleCommands(mode);
+
+        // Whatever published it, MQTT included, the next change made here
+        // builds on it.
+        lampConfig next;
+        if(configBlock.read(next, configVersion))
+        {
+            controlConfig = next;
+            applyConfig(next);
+        }
+
+#ifdef ENCODER
+        encoderFrame();
+#endif
+
+#ifdef AMBIENT_SENSOR
+        // Modes only show frames when they change something, so put the
+        // new brightness out here.
+        if(ambientBrightness() != outputBrightness)
+        {
+            setBrightness(ambientBrightness());
+            show();
+        }
+#endif
 
         runMode(mode);
     }
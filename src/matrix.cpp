@@ -0,0 +1,177 @@
+#include "matrix.h"
+#include "hot.h"
+
+static const uint8_t smallDigitGlyphs[] = {
+    0x40, 0xa0, 0x40, 0x00, 0x00, // +
+    0x00, 0x00, 0x00, 0x40, 0x80, // ,
+    0x00, 0x00, 0xe0, 0x00, 0x00, // -
+    0x00, 0x00, 0x00, 0x00, 0x40, // .
+    0x20, 0x20, 0x40, 0x80, 0x80, // /
+    0xe0, 0xa0, 0xa0, 0xa0, 0xe0, // 0
+    0x40, 0xc0, 0x40, 0x40, 0xe0, // 1
+    0xe0, 0x20, 0xe0, 0x80, 0xe0, // 2
+    0xe0, 0x20, 0x60, 0x20, 0xe0, // 3
+    0xa0, 0xa0, 0xe0, 0x20, 0x20, // 4
+    0xe0, 0x80, 0xe0, 0x20, 0xe0, // 5
+    0xe0, 0x80, 0xe0, 0xa0, 0xe0, // 6
+    0xe0, 0x20, 0x20, 0x40, 0x40, // 7
+    0xe0, 0xa0, 0xe0, 0xa0, 0xe0, // 8
+    0xe0, 0xa0, 0xe0, 0x20, 0xe0, // 9
+    0x00, 0x40, 0x00, 0x40, 0x00, // :
+};
+
+const font smallDigits = {3, 5, '+', ':', smallDigitGlyphs};
+
+matrix::matrix(uint8_t* pixels, uint16_t offset, uint16_t width,
+               uint16_t height, matrixLayout layout, const uint8_t order[4]) :
+    pixels(pixels),
+    offset(offset),
+    w(width),
+    h(height),
+    layout(layout)
+{
+    for (uint8_t i = 0; i < 4; i++)
+        channel[order[i]] = i;
+}
+
+uint16_t matrix::index(uint16_t x, uint16_t y) const
+{
+    if (layout == matrixSerpentine && (y & 1))
+        x = w - 1 - x;
+    return offset + y * w + x;
+}
+
+void matrix::toWire(const RgbwColor& col, uint8_t* out) const
+{
+    out[channel[0]] = col.R;
+    out[channel[1]] = col.G;
+    out[channel[2]] = col.B;
+    out[channel[3]] = col.W;
+}
+
+uint8_t* matrix::rowStart(int x, int y, int& step) const
+{
+    step = layout == matrixSerpentine && (y & 1) ? -4 : 4;
+    return pixels + index(x, y) * 4;
+}
+
+void matrix::set(int x, int y, const RgbwColor& col)
+{
+    if (x < 0 || y < 0 || x >= w || y >= h)
+        return;
+    toWire(col, pixels + index(x, y) * 4);
+}
+
+void matrix::fill(int x, int y, int width, int height, const RgbwColor& col)
+{
+    // Clip to the panel.
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    if (x + width > w)
+        width = w - x;
+    if (y + height > h)
+        height = h - y;
+    if (width <= 0 || height <= 0)
+        return;
+
+    uint8_t c[4];
+    toWire(col, c);
+    for (int row = y; row < y + height; row++) {
+        int step;
+        uint8_t* p = rowStart(x, row, step);
+        for (int i = 0; i < width; i++, p += step) {
+            p[0] = c[0];
+            p[1] = c[1];
+            p[2] = c[2];
+            p[3] = c[3];
+        }
+    }
+}
+
+void LAMP_HOT matrix::blit(const sprite& s, int x, int y,
+                           uint8_t alpha)
+{
+    // Clip, keeping track of where in the sprite the visible part starts.
+    int sx = 0, sy = 0;
+    int width = s.width, height = s.height;
+    if (x < 0) {
+        sx = -x;
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        sy = -y;
+        height += y;
+        y = 0;
+    }
+    if (x + width > w)
+        width = w - x;
+    if (y + height > h)
+        height = h - y;
+    if (width <= 0 || height <= 0 || alpha == 0)
+        return;
+
+    // Look the palette up once, in wire order.
+    uint8_t palette[256][4];
+    for (uint16_t i = 0; i < s.paletteSize && i < 256; i++)
+        toWire(s.palette[i], palette[i]);
+
+    for (int row = 0; row < height; row++) {
+        int step;
+        uint8_t* p = rowStart(x, y + row, step);
+        const uint8_t* src = s.pixels + (sy + row) * s.width + sx;
+
+        for (int i = 0; i < width; i++, p += step) {
+            uint8_t idx = src[i];
+            if (idx == s.transparent || idx >= s.paletteSize)
+                continue;
+
+            const uint8_t* c = palette[idx];
+            if (alpha == 255) {
+                p[0] = c[0];
+                p[1] = c[1];
+                p[2] = c[2];
+                p[3] = c[3];
+            } else {
+                for (int b = 0; b < 4; b++)
+                    p[b] += ((c[b] - p[b]) * alpha) >> 8;
+            }
+        }
+    }
+}
+
+int matrix::text(const font& f, int x, int y, const char* str,
+                 const RgbwColor& col)
+{
+    uint8_t c[4];
+    toWire(col, c);
+
+    for (; *str; str++, x += f.width + 1) {
+        if (*str < f.first || *str > f.last)
+            continue;
+        const uint8_t* glyph = f.glyphs + (*str - f.first) * f.height;
+
+        for (int row = 0; row < f.height; row++) {
+            int py = y + row;
+            if (py < 0 || py >= h)
+                continue;
+            for (int i = 0; i < f.width; i++) {
+                int px = x + i;
+                if (px < 0 || px >= w || !(glyph[row] & (0x80 >> i)))
+                    continue;
+                uint8_t* p = pixels + index(px, py) * 4;
+                p[0] = c[0];
+                p[1] = c[1];
+                p[2] = c[2];
+                p[3] = c[3];
+            }
+        }
+    }
+    return x;
+}
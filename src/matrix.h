@@ -0,0 +1,88 @@
+#pragma once
+#include <NeoPixelBus.h>
+
+// 2D drawing on LED matrix panels.
+//
+// matrix draws straight into the raw pixel buffer of the bus the panel is
+// on, in the order the bytes go out on the wire, so whatever's drawn goes
+// through the same output stage as the ring. Panels are wired a row at a
+// time, so every row is a contiguous run of pixels, running either way; the
+// blitter works a row at a time to match, clipping each row to the panel
+// before it starts.
+
+enum matrixLayout
+{
+    // Every row runs left to right.
+    matrixRows,
+    // Rows alternate direction, zigzagging down the panel. This is how most
+    // panels are wired.
+    matrixSerpentine,
+};
+
+// An 8 bit paletted image. Pixels are indices into palette, a row at a time.
+struct sprite
+{
+    uint16_t width;
+    uint16_t height;
+    const uint8_t* pixels;
+    const RgbwColor* palette;
+    uint16_t paletteSize;
+    // Index that isn't drawn, or -1 to draw them all.
+    int16_t transparent;
+};
+
+// A 1 bit font. Each glyph is height bytes, one per row, with the leftmost
+// pixel in the top bit.
+struct font
+{
+    uint8_t width;
+    uint8_t height;
+    char first;
+    char last;
+    const uint8_t* glyphs;
+};
+
+// Digits, and a few symbols for clocks and counters, 3x5.
+extern const font smallDigits;
+
+class matrix
+{
+public:
+    // pixels is the bus buffer, with the panel's first pixel at offset.
+    // order[i] is the RGBW channel that goes out in byte i.
+    matrix(uint8_t* pixels, uint16_t offset, uint16_t width, uint16_t height,
+           matrixLayout layout, const uint8_t order[4]);
+
+    uint16_t width() const {return w;}
+    uint16_t height() const {return h;}
+
+    // index returns the bus pixel at x, y.
+    uint16_t index(uint16_t x, uint16_t y) const;
+
+    void set(int x, int y, const RgbwColor& col);
+    void fill(int x, int y, int width, int height, const RgbwColor& col);
+    void clear(const RgbwColor& col) {fill(0, 0, w, h, col);}
+
+    // blit draws s with its top left at x, y, mixed alpha/255 over what's
+    // there.
+    void blit(const sprite& s, int x, int y, uint8_t alpha = 255);
+
+    // text draws str with its top left at x, y, and returns the x just past
+    // the end.
+    int text(const font& f, int x, int y, const char* str,
+             const RgbwColor& col);
+
+private:
+    // rowStart returns where the run for the pixels at x..x+n-1 of row y
+    // starts in the buffer and which way it runs, in bytes.
+    uint8_t* rowStart(int x, int y, int& step) const;
+    void toWire(const RgbwColor& col, uint8_t* out) const;
+
+    uint8_t* pixels;
+    uint16_t offset;
+    uint16_t w;
+    uint16_t h;
+    matrixLayout layout;
+    // Byte offset of R, G, B and W within a pixel.
+    uint8_t channel[4];
+};
@@ -0,0 +1,207 @@
+#include <math.h>
+#include <string.h>
+#include "modulation.h"
+#include "rng.h"
+
+// A walk that's been left alone this long just starts again from where it
+// was, rather than working through every step it missed.
+static const uint16_t MaxCatchUp = 64;
+
+modSource modGraph::add(sourceType type, float depth, modSource input)
+{
+    if (count >= MaxModSources || input >= count)
+        return -1;
+
+    source& s = sources[count];
+    memset(&s, 0, sizeof(s));
+    s.type = type;
+    s.depth = depth;
+    s.input = input;
+    return count++;
+}
+
+modSource modGraph::addLfo(lfoShape shape, uint32_t periodMs, float depth,
+                           modSource input)
+{
+    modSource id = add(sourceLfo, depth, input);
+    if (id >= 0) {
+        sources[id].shape = shape;
+        sources[id].period = periodMs ? periodMs : 1;
+    }
+    return id;
+}
+
+modSource modGraph::addEnvelope(uint32_t attackMs, uint32_t decayMs,
+                                float sustain, uint32_t releaseMs, float depth,
+                                modSource input)
+{
+    modSource id = add(sourceEnvelope, depth, input);
+    if (id >= 0) {
+        source& s = sources[id];
+        s.attack = attackMs;
+        s.decay = decayMs;
+        s.sustain = sustain;
+        s.release = releaseMs;
+    }
+    return id;
+}
+
+modSource modGraph::addRandomWalk(uint32_t stepMs, float stepSize,
+                                  float depth, modSource input)
+{
+    modSource id = add(sourceWalk, depth, input);
+    if (id >= 0) {
+        sources[id].period = stepMs ? stepMs : 1;
+        sources[id].stepSize = stepSize;
+    }
+    return id;
+}
+
+// invalidate forgets every cached value. Changing one source changes what
+// any source that takes it as an input gives too, and those may already have
+// cached a value for this time.
+void modGraph::invalidate()
+{
+    for (uint8_t i = 0; i < count; i++)
+        sources[i].valid = false;
+}
+
+void modGraph::setDepth(modSource id, float depth)
+{
+    if (id >= 0 && id < count) {
+        sources[id].depth = depth;
+        invalidate();
+    }
+}
+
+void modGraph::setPeriod(modSource id, uint32_t periodMs)
+{
+    if (id >= 0 && id < count) {
+        sources[id].period = periodMs ? periodMs : 1;
+        invalidate();
+    }
+}
+
+void modGraph::trigger(modSource id, uint32_t now)
+{
+    if (id < 0 || id >= count)
+        return;
+    source& s = sources[id];
+    s.triggered = true;
+    s.released = false;
+    s.triggeredAt = now;
+    invalidate();
+}
+
+void modGraph::release(modSource id, uint32_t now)
+{
+    if (id < 0 || id >= count)
+        return;
+    source& s = sources[id];
+    if (!s.triggered || s.released)
+        return;
+    s.releaseFrom = envelope(s, now);
+    s.released = true;
+    s.releasedAt = now;
+    invalidate();
+}
+
+float modGraph::lfo(const source& s, uint32_t now) const
+{
+    float phase = float(now % s.period) / s.period;
+    switch (s.shape) {
+    case lfoSine:
+        return sinf(phase * 2.0f * float(M_PI));
+    case lfoTriangle:
+        return phase < 0.5f ? phase * 4.0f - 1.0f : 3.0f - phase * 4.0f;
+    case lfoSaw:
+        return phase * 2.0f - 1.0f;
+    case lfoSquare:
+    default:
+        return phase < 0.5f ? 1.0f : -1.0f;
+    }
+}
+
+// envelope returns the envelope's level from 0 to 1, before depth.
+float modGraph::envelope(const source& s, uint32_t now) const
+{
+    if (!s.triggered)
+        return 0.0f;
+
+    if (s.released) {
+        uint32_t t = now - s.releasedAt;
+        if (t >= s.release)
+            return 0.0f;
+        return s.releaseFrom * (1.0f - float(t) / s.release);
+    }
+
+    uint32_t t = now - s.triggeredAt;
+    if (t < s.attack)
+        return float(t) / s.attack;
+    t -= s.attack;
+    if (t < s.decay)
+        return 1.0f - (1.0f - s.sustain) * float(t) / s.decay;
+    return s.sustain;
+}
+
+float modGraph::walk(source& s, uint32_t now)
+{
+    uint32_t steps = (now - s.steppedAt) / s.period;
+    if (steps == 0)
+        return s.position;
+    s.steppedAt += steps * s.period;
+
+    if (steps > MaxCatchUp)
+        steps = MaxCatchUp;
+    while (steps--) {
+        s.position += s.stepSize * (rngRandom(2001) - 1000) / 1000.0f;
+        if (s.position > 1.0f)
+            s.position = 1.0f;
+        if (s.position < -1.0f)
+            s.position = -1.0f;
+    }
+    return s.position;
+}
+
+float modGraph::value(modSource id, uint32_t now)
+{
+    if (id < 0 || id >= count)
+        return 0.0f;
+
+    source& s = sources[id];
+    if (s.valid && s.cachedAt == now)
+        return s.cached;
+
+    float v;
+    switch (s.type) {
+    case sourceLfo:
+        v = lfo(s, now);
+        break;
+    case sourceEnvelope:
+        v = envelope(s, now);
+        break;
+    case sourceWalk:
+    default:
+        v = walk(s, now);
+        break;
+    }
+    v *= s.depth;
+    // Inputs are always earlier sources, so this can't go round in circles.
+    if (s.input >= 0 && v != 0.0f)
+        v *= value(s.input, now);
+
+    s.cached = v;
+    s.cachedAt = now;
+    s.valid = true;
+    return v;
+}
+
+uint16_t modGraph::modulate(uint16_t base, modSource id, uint32_t now)
+{
+    float v = base * (1.0f + value(id, now));
+    if (v <= 0.0f)
+        return 0;
+    if (v >= 65535.0f)
+        return 65535;
+    return uint16_t(v);
+}
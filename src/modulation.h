@@ -0,0 +1,114 @@
+#pragma once
+#include <stdint.h>
+
+// Modulation for mode parameters.
+//
+// A modGraph holds a handful of sources, LFOs, envelopes and random walks,
+// each of which gives a value from -depth to depth (envelopes from 0 to
+// depth). A source can take another source as its input, which scales its
+// output, so an envelope can fade an LFO in, say. Inputs have to be added
+// before the sources that use them, which keeps the graph free of loops.
+//
+// Nothing is worked out until something asks for a value, and then only once
+// per frame time: value() caches what it computes against the time, so any
+// number of pixels can read a source for the price of one evaluation, and a
+// source nobody reads costs nothing.
+//
+// LFOs and envelopes are worked out from the time alone. Random walks keep
+// state, but catch up on any steps they missed while nobody was asking.
+
+enum lfoShape
+{
+    lfoSine,
+    lfoTriangle,
+    // Ramps up from -1 to 1 and drops back.
+    lfoSaw,
+    lfoSquare,
+};
+
+const uint8_t MaxModSources = 8;
+
+// A source id. -1 is no source, which always reads as zero.
+typedef int8_t modSource;
+
+class modGraph
+{
+public:
+    // Each add returns the new source's id, or -1 if the graph is full.
+    modSource addLfo(lfoShape shape, uint32_t periodMs, float depth,
+                     modSource input = -1);
+    // The envelope rises to depth over attackMs once triggered, falls to
+    // sustain * depth over decayMs and stays there until released, when it
+    // falls to zero over releaseMs.
+    modSource addEnvelope(uint32_t attackMs, uint32_t decayMs, float sustain,
+                          uint32_t releaseMs, float depth,
+                          modSource input = -1);
+    // The walk moves up or down by up to stepSize * depth every stepMs,
+    // staying between -depth and depth.
+    modSource addRandomWalk(uint32_t stepMs, float stepSize, float depth,
+                            modSource input = -1);
+
+    // clear removes every source.
+    void clear() {count = 0;}
+    void setDepth(modSource id, float depth);
+    void setPeriod(modSource id, uint32_t periodMs);
+
+    void trigger(modSource id, uint32_t now);
+    void release(modSource id, uint32_t now);
+
+    // value returns what id gives at time now.
+    float value(modSource id, uint32_t now);
+
+    // modulate returns base scaled by 1 + value(id, now), limited to what
+    // fits in a uint16_t.
+    uint16_t modulate(uint16_t base, modSource id, uint32_t now);
+
+private:
+    enum sourceType
+    {
+        sourceLfo,
+        sourceEnvelope,
+        sourceWalk,
+    };
+
+    struct source
+    {
+        sourceType type;
+        lfoShape shape;
+        modSource input;
+        float depth;
+        // The LFO period, or the walk's step.
+        uint32_t period;
+        // Envelope stages.
+        uint32_t attack;
+        uint32_t decay;
+        float sustain;
+        uint32_t release;
+        // When the envelope was triggered and released. Released before
+        // triggered means it's held.
+        uint32_t triggeredAt;
+        uint32_t releasedAt;
+        // The level the release falls from, wherever the envelope had got to.
+        float releaseFrom;
+        bool triggered;
+        bool released;
+        // The walk's position, from -1 to 1, and when it last stepped.
+        float position;
+        uint32_t steppedAt;
+        float stepSize;
+
+        // The last value and the time it was for.
+        float cached;
+        uint32_t cachedAt;
+        bool valid;
+    };
+
+    modSource add(sourceType type, float depth, modSource input);
+    void invalidate();
+    float lfo(const source& s, uint32_t now) const;
+    float envelope(const source& s, uint32_t now) const;
+    float walk(source& s, uint32_t now);
+
+    source sources[MaxModSources];
+    uint8_t count = 0;
+};
@@ -0,0 +1,194 @@
+#ifdef MQTT_CONTROL
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include "mqtt.h"
+
+#if !defined(WIFI_SSID) || !defined(WIFI_PASSWORD) || !defined(MQTT_BROKER)
+#error "MQTT_CONTROL needs WIFI_SSID, WIFI_PASSWORD and MQTT_BROKER defined"
+#endif
+
+#ifndef MQTT_NAME
+#define MQTT_NAME "lamp"
+#endif
+
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+
+static const uint32_t telemetryInterval = 5000;
+
+spscQueue<lampCommand, 16> mqttCommands;
+
+static WiFiClient wifi;
+static PubSubClient client(wifi);
+static seqlock<lampConfig>* configs;
+static configParser sceneParser;
+// The latest config, as a base for scenes to change.
+static lampConfig sceneBase;
+static uint32_t sceneVersion = 0;
+
+static uint8_t modeCount;
+
+// Time from arriving to showing, in us.
+struct latency
+{
+    volatile uint32_t last;
+    volatile uint32_t max;
+    volatile uint32_t total;
+    volatile uint32_t count;
+};
+
+// What the render loop last told us, and latency for commands and scenes.
+// These are only ever written by one side, and 32 bit stores are atomic.
+static volatile uint8_t stateMode;
+static volatile uint8_t stateBrightness;
+static volatile uint32_t stateMilliamps;
+static latency commandLatency;
+static latency sceneLatency;
+static uint32_t dropped = 0;
+static uint32_t rejected = 0;
+
+static bool isTopic(const char* topic, const char* leaf)
+{
+    size_t len = strlen(MQTT_NAME);
+    return strncmp(topic, MQTT_NAME, len) == 0 && topic[len] == '/' &&
+           strcmp(topic + len + 1, leaf) == 0;
+}
+
+// payloadNumber reads a payload that's a whole number from 0 to max into
+// value. Anything else, empty or with anything but digits in it, is refused.
+static bool payloadNumber(const uint8_t* payload, unsigned int len,
+                          uint16_t max, uint16_t& value)
+{
+    if (len == 0 || len > 5)
+        return false;
+    uint32_t v = 0;
+    for (unsigned int i = 0; i < len; i++) {
+        if (payload[i] < '0' || payload[i] > '9')
+            return false;
+        v = v * 10 + (payload[i] - '0');
+    }
+    if (v > max)
+        return false;
+    value = v;
+    return true;
+}
+
+static void onMessage(char* topic, uint8_t* payload, unsigned int len)
+{
+    lampCommand cmd;
+    cmd.received = micros();
+
+    bool ok;
+    if (isTopic(topic, "scene")) {
+        configs->read(sceneBase, sceneVersion);
+        sceneParser.begin(sceneBase);
+        configStatus status = configMore;
+        for (unsigned int i = 0; i < len && status == configMore; i++)
+            status = sceneParser.feed(payload[i]);
+        ok = status == configDone;
+        if (ok)
+            configs->publish(sceneParser.result());
+        cmd.type = commandScene;
+        cmd.value = 0;
+    } else if (isTopic(topic, "mode")) {
+        ok = modeCount > 0 && payloadNumber(payload, len, modeCount - 1,
+                                            cmd.value);
+        cmd.type = commandMode;
+    } else if (isTopic(topic, "brightness")) {
+        ok = payloadNumber(payload, len, 255, cmd.value);
+        cmd.type = commandBrightness;
+    } else {
+        return;
+    }
+
+    if (!ok)
+        rejected++;
+    else if (!mqttCommands.push(cmd))
+        dropped++;
+}
+
+static void publishTelemetry()
+{
+    char buf[256];
+    uint32_t count = commandLatency.count;
+    uint32_t scenes = sceneLatency.count;
+    snprintf(buf, sizeof(buf),
+        "{\"mode\":%u,\"brightness\":%u,\"mA\":%u,\"latencyUs\":%u,"
+        "\"latencyMaxUs\":%u,\"latencyAvgUs\":%u,\"sceneLatencyUs\":%u,"
+        "\"sceneLatencyMaxUs\":%u,\"sceneLatencyAvgUs\":%u,"
+        "\"dropped\":%u,\"rejected\":%u}",
+        unsigned(stateMode), unsigned(stateBrightness),
+        unsigned(stateMilliamps), unsigned(commandLatency.last),
+        unsigned(commandLatency.max),
+        unsigned(count ? commandLatency.total / count : 0),
+        unsigned(sceneLatency.last), unsigned(sceneLatency.max),
+        unsigned(scenes ? sceneLatency.total / scenes : 0),
+        unsigned(dropped), unsigned(rejected));
+    client.publish(MQTT_NAME "/telemetry", buf);
+}
+
+static void mqttTask(void*)
+{
+    uint32_t lastTelemetry = 0;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    client.setServer(MQTT_BROKER, MQTT_PORT);
+    client.setCallback(onMessage);
+
+    while (true) {
+        if (WiFi.status() != WL_CONNECTED) {
+            vTaskDelay(pdMS_TO_TICKS(500));
+            continue;
+        }
+
+        if (!client.connected()) {
+            if (client.connect(MQTT_NAME)) {
+                client.subscribe(MQTT_NAME "/mode");
+                client.subscribe(MQTT_NAME "/brightness");
+                client.subscribe(MQTT_NAME "/scene");
+            } else {
+                vTaskDelay(pdMS_TO_TICKS(2000));
+                continue;
+            }
+        }
+
+        client.loop();
+        if (millis() - lastTelemetry >= telemetryInterval) {
+            lastTelemetry = millis();
+            publishTelemetry();
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+void mqttBegin(seqlock<lampConfig>* configBlock, uint8_t modes)
+{
+    configs = configBlock;
+    modeCount = modes;
+    // Arduino renders on core 1, so the network gets core 0.
+    xTaskCreatePinnedToCore(mqttTask, "mqtt", 6144, nullptr, 1, nullptr, 0);
+}
+
+void mqttState(uint8_t mode, uint8_t brightness, uint32_t milliamps)
+{
+    stateMode = mode;
+    stateBrightness = brightness;
+    stateMilliamps = milliamps;
+}
+
+void mqttShown(commandType type, uint32_t received)
+{
+    latency& l = type == commandScene ? sceneLatency : commandLatency;
+    uint32_t us = micros() - received;
+    l.last = us;
+    if (us > l.max)
+        l.max = us;
+    l.total += us;
+    l.count++;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+#include "config.h"
+#include "seqlock.h"
+#include "spscqueue.h"
+
+// MQTT control, built in when MQTT_CONTROL is defined.
+//
+// The client runs in its own task on core 0, away from the render loop. It
+// subscribes to
+//   <MQTT_NAME>/mode        mode number
+//   <MQTT_NAME>/brightness  0-255
+//   <MQTT_NAME>/scene       a config object, see config.h
+// and publishes telemetry to <MQTT_NAME>/telemetry every few seconds. Mode
+// and brightness go to the render loop through mqttCommands; scenes are
+// parsed in the MQTT task and published through the config seqlock, with a
+// commandScene after them so the render loop can tell when one arrived.
+// Anything that isn't a number in range, or a config that parses, is
+// dropped and counted as rejected. The telemetry includes the time from
+// each command, and separately each scene, arriving to the first frame
+// showing it.
+
+enum commandType : uint8_t
+{
+    commandMode,
+    commandBrightness,
+    commandScene,
+};
+
+struct lampCommand
+{
+    commandType type;
+    uint16_t value;
+    // micros() when the command arrived.
+    uint32_t received;
+};
+
+extern spscQueue<lampCommand, 16> mqttCommands;
+
+// mqttBegin connects to WiFi and the broker in the background. Scenes are
+// published to configBlock, and modes from 0 to modes - 1 are accepted.
+void mqttBegin(seqlock<lampConfig>* configBlock, uint8_t modes);
+
+// mqttState tells the telemetry what the lamp is doing. It's cheap enough to
+// call every frame.
+void mqttState(uint8_t mode, uint8_t brightness, uint32_t milliamps);
+
+// mqttShown notes that the first frame after a command of type that
+// arrived at received (in micros()) has gone out.
+void mqttShown(commandType type, uint32_t received);
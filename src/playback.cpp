@@ -0,0 +1,261 @@
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "playback.h"
+#include "spscqueue.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <esp_vfs_fat.h>
+#include <driver/sdspi_host.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+// Buffers go round from the reader to the render loop through filled and
+// back through empty, so each queue only ever has one task at either end.
+static spscQueue<uint8_t, 16> filled;
+static spscQueue<uint8_t, 16> empty;
+static uint8_t* buffers;
+static size_t bufferBytes;
+
+static FILE* show;
+static showHeader header;
+static std::atomic<bool> stopping;
+static std::atomic<bool> reading;
+// A buffer the reader took and couldn't fill, to try again with. Giving it
+// back through empty would make the reader a second task pushing there.
+static int retrySlot = -1;
+
+// The next frame of the show the render loop will take.
+static uint32_t consumed;
+static uint32_t lastMissed;
+
+static uint32_t underruns;
+static uint32_t shown;
+// The slowest read of a frame, in us.
+static std::atomic<uint32_t> slowestRead;
+
+// clockUs is what reads are timed with.
+static uint32_t clockUs()
+{
+#ifdef ARDUINO
+    return micros();
+#else
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// readFrame reads the next frame into buf, going back to the start at the
+// end of the show.
+static bool readFrame(uint8_t* buf)
+{
+    memset(buf, 0, bufferBytes);
+    size_t keep = header.frameBytes < bufferBytes ? header.frameBytes
+                                                  : bufferBytes;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (fread(buf, 1, keep, show) == keep &&
+            fseek(show, header.frameBytes - keep, SEEK_CUR) == 0)
+            return true;
+        fseek(show, sizeof(header), SEEK_SET);
+    }
+    return false;
+}
+
+static void readAhead()
+{
+    while (!stopping) {
+        uint8_t slot;
+        if (retrySlot >= 0) {
+            slot = retrySlot;
+            retrySlot = -1;
+        } else if (!empty.pop(slot)) {
+            return;
+        }
+
+        uint32_t start = clockUs();
+        bool ok = readFrame(buffers + slot * bufferBytes);
+        uint32_t took = clockUs() - start;
+        if (took > slowestRead)
+            slowestRead = took;
+
+        if (!ok) {
+            // Leave the render loop to count underruns.
+            retrySlot = slot;
+            return;
+        }
+        filled.push(slot);
+    }
+}
+
+#ifdef ARDUINO
+static void readerTask(void*)
+{
+    while (!stopping) {
+        readAhead();
+        vTaskDelay(1);
+    }
+    reading = false;
+    vTaskDelete(nullptr);
+}
+
+bool playbackMount(uint8_t csPin)
+{
+    // The feather's SPI pins. The default slot config uses GPIO13, which is
+    // the pixels.
+    sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    host.slot = VSPI_HOST;
+    sdspi_slot_config_t slot = SDSPI_SLOT_CONFIG_DEFAULT();
+    slot.gpio_miso = 19;
+    slot.gpio_mosi = 18;
+    slot.gpio_sck = 5;
+    slot.gpio_cs = csPin;
+
+    esp_vfs_fat_sdmmc_mount_config_t mount = {};
+    mount.format_if_mount_failed = false;
+    mount.max_files = 2;
+    sdmmc_card_t* card;
+    return esp_vfs_fat_sdmmc_mount("/sd", &host, &slot, &mount, &card) ==
+           ESP_OK;
+}
+
+static void startReader()
+{
+    xTaskCreatePinnedToCore(readerTask, "playback", 3072, nullptr, 1,
+                            nullptr, 0);
+}
+
+static void waitForReader()
+{
+    while (reading)
+        vTaskDelay(1);
+}
+#else
+static std::thread reader;
+
+bool playbackMount(uint8_t)
+{
+    return true;
+}
+
+static void startReader()
+{
+    reader = std::thread([] {
+        while (!stopping) {
+            readAhead();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        reading = false;
+    });
+}
+
+static void waitForReader()
+{
+    if (reader.joinable())
+        reader.join();
+}
+#endif
+
+bool playbackOpen(const char* path, size_t frameBytes, uint32_t first)
+{
+    playbackClose();
+
+    show = fopen(path, "rb");
+    if (!show)
+        return false;
+    if (fread(&header, sizeof(header), 1, show) != 1 ||
+        memcmp(header.magic, "LSHW", 4) != 0 || header.frameBytes == 0 ||
+        header.frameMs == 0) {
+        fclose(show);
+        show = nullptr;
+        return false;
+    }
+    // Shows go round, so any frame can be started from.
+    if (header.frames)
+        fseek(show, sizeof(header) +
+              long(first % header.frames) * header.frameBytes, SEEK_SET);
+
+    bufferBytes = frameBytes;
+    buffers = (uint8_t*)malloc(PlaybackBuffers * frameBytes);
+    if (!buffers) {
+        fclose(show);
+        show = nullptr;
+        return false;
+    }
+
+    uint8_t slot;
+    while (filled.pop(slot))
+        ;
+    while (empty.pop(slot))
+        ;
+    for (uint8_t i = 0; i < PlaybackBuffers; i++)
+        empty.push(i);
+    retrySlot = -1;
+
+    consumed = first;
+    lastMissed = UINT32_MAX;
+    stopping = false;
+    reading = true;
+    startReader();
+    return true;
+}
+
+void playbackClose()
+{
+    if (!show)
+        return;
+    stopping = true;
+    waitForReader();
+    fclose(show);
+    show = nullptr;
+    free(buffers);
+    buffers = nullptr;
+}
+
+bool playbackActive()
+{
+    return show != nullptr && reading;
+}
+
+uint16_t playbackFrameMs()
+{
+    return header.frameMs;
+}
+
+bool playbackFrame(uint32_t due, uint8_t* out)
+{
+    if (!show)
+        return false;
+
+    // Take every frame up to due, and only keep the last, so a show that
+    // fell behind catches up.
+    bool changed = false;
+    while (consumed <= due) {
+        uint8_t slot;
+        if (!filled.pop(slot)) {
+            if (due != lastMissed) {
+                underruns++;
+                lastMissed = due;
+            }
+            break;
+        }
+        if (consumed == due) {
+            memcpy(out, buffers + slot * bufferBytes, bufferBytes);
+            changed = true;
+            shown++;
+        }
+        empty.push(slot);
+        consumed++;
+    }
+    return changed;
+}
+
+void playbackReport(Print& out)
+{
+    out.printf("playback: %u frames shown, %u underruns, slowest read %u us\n",
+        unsigned(shown), unsigned(underruns), unsigned(slowestRead.load()));
+}
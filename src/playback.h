@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <Print.h>
+
+// Playback of shows recorded to an SD card, too long to fit in flash.
+//
+// A show file is a showHeader followed by frames in wire order, back to
+// back; tools/render.py --show writes them. A task on core 0 reads frames
+// ahead into a ring of PlaybackBuffers buffers, so the card's latency
+// spikes, which can run to hundreds of ms, land on the reader and not on
+// the frame clock. If the reader still falls behind, the frame on the
+// pixels stays up, the miss is counted as an underrun, and the show skips
+// ahead to catch up once frames arrive again.
+//
+// On the ESP32 the card is read over SPI, with DMA, through FATFS. Host
+// builds read an ordinary file, on a thread.
+
+struct showHeader
+{
+    char magic[4];  // "LSHW"
+    uint16_t frameBytes;
+    // Frame time between frames.
+    uint16_t frameMs;
+    uint32_t frames;
+};
+
+const uint8_t PlaybackBuffers = 15;
+
+// playbackMount mounts the card at /sd, with its chip select on csPin.
+bool playbackMount(uint8_t csPin);
+
+// playbackOpen starts reading path ahead from frame first. The show's
+// frames are copied to buffers of frameBytes bytes, cut short or padded out
+// if need be.
+bool playbackOpen(const char* path, size_t frameBytes, uint32_t first = 0);
+void playbackClose();
+// playbackActive says whether a show is open, with its reader running.
+bool playbackActive();
+
+uint16_t playbackFrameMs();
+
+// playbackFrame puts frame due of the show, counting from zero, into out.
+// It returns false if out already had it or the frame isn't ready yet.
+bool playbackFrame(uint32_t due, uint8_t* out);
+
+void playbackReport(Print& out);
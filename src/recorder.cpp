@@ -0,0 +1,226 @@
+#include <esp_attr.h>
+#include "recorder.h"
+#include "hot.h"
+
+// Record flags
+static const uint8_t flagKey = 0x01;
+static const uint8_t flagMode = 0x02;
+static const uint8_t flagEvents = 0x04;
+
+static const uint32_t recorderMagic = 0x464c5432; // "FLT2"
+
+// Everything here survives a reset, so it's checked with the magic and
+// some sanity checks before being trusted.
+struct recorderStore
+{
+    uint32_t magic;
+    uint32_t frameBytes;
+    // Oldest record, next free byte and bytes in use in data.
+    uint32_t tail;
+    uint32_t head;
+    uint32_t used;
+    uint32_t frames;
+    uint32_t lastMs;
+    uint16_t sinceKey;
+    uint8_t mode;
+    uint8_t lastMode;
+    uint8_t events;
+    // Encoding cost, in us.
+    uint32_t costTotal;
+    uint32_t costMax;
+    uint32_t costFrames;
+    uint8_t data[RecorderBytes];
+};
+
+static __NOINIT_ATTR recorderStore store;
+// The last frame recorded, for working out the next delta, and scratch space
+// for building a record before it goes into the ring. Neither has to survive
+// a reset, since recording starts again with a keyframe, so they're sized
+// for the frames at hand.
+static uint8_t* prev;
+static uint8_t* scratch;
+static bool recording;
+
+static uint8_t LAMP_HOT peek(uint32_t pos)
+{
+    return store.data[pos % RecorderBytes];
+}
+
+static void LAMP_HOT push(const uint8_t* bytes, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        store.data[store.head] = bytes[i];
+        store.head = (store.head + 1) % RecorderBytes;
+    }
+    store.used += len;
+}
+
+// dropOldest discards the record at the tail.
+static void LAMP_HOT dropOldest()
+{
+    uint32_t len = 2 + (peek(store.tail) | (peek(store.tail + 1) << 8));
+    store.tail = (store.tail + len) % RecorderBytes;
+    store.used -= len;
+}
+
+static size_t LAMP_HOT putVarint(uint8_t* out, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = v | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+bool recorderBegin(size_t frameBytes)
+{
+    free(prev);
+    free(scratch);
+    prev = scratch = nullptr;
+    if (frameBytes > 0 && frameBytes <= RecorderMaxFrame) {
+        prev = (uint8_t*)calloc(frameBytes, 1);
+        // A delta costs at most two bytes of run header per changed byte.
+        scratch = (uint8_t*)malloc(frameBytes * 3 + 16);
+    }
+    recording = prev && scratch;
+
+    bool valid = store.magic == recorderMagic &&
+                 store.frameBytes == frameBytes &&
+                 store.used <= RecorderBytes &&
+                 store.head < RecorderBytes && store.tail < RecorderBytes;
+    if (valid) {
+        // Start the next recording with a keyframe so it decodes on its own.
+        store.sinceKey = RecorderKeyInterval;
+        // millis() has started over, so the next frame's time can't be a
+        // step from the last one recorded.
+        store.lastMs = 0;
+        store.events |= RecorderEventReset;
+        return true;
+    }
+
+    memset(&store, 0, sizeof(store) - sizeof(store.data));
+    store.frameBytes = frameBytes > RecorderMaxFrame ? 0 : frameBytes;
+    store.sinceKey = RecorderKeyInterval;
+    store.lastMode = 0xff;
+    store.magic = recorderMagic;
+    return false;
+}
+
+bool recorderRecording()
+{
+    return recording;
+}
+
+void recorderMode(uint8_t mode)
+{
+    store.mode = mode;
+}
+
+void recorderEvent(uint8_t event)
+{
+    store.events |= event;
+}
+
+void LAMP_HOT recorderFrame(uint32_t ms, const uint8_t* pixels)
+{
+    const uint32_t frameBytes = store.frameBytes;
+    if (!recording || frameBytes == 0)
+        return;
+
+    unsigned long start = micros();
+
+    // Leave room for the length, which is filled in at the end.
+    size_t len = 2;
+    uint8_t flags = 0;
+    size_t flagPos = len++;
+
+    // Keyframes repeat the mode too, so decoding can start at any of them.
+    bool key = ++store.sinceKey >= RecorderKeyInterval;
+
+    len += putVarint(scratch + len, ms - store.lastMs);
+    store.lastMs = ms;
+    if (key || store.mode != store.lastMode) {
+        flags |= flagMode;
+        scratch[len++] = store.mode;
+        store.lastMode = store.mode;
+    }
+    if (store.events) {
+        flags |= flagEvents;
+        scratch[len++] = store.events;
+        store.events = 0;
+    }
+
+    if (key) {
+        flags |= flagKey;
+        store.sinceKey = 0;
+        memcpy(scratch + len, pixels, frameBytes);
+        len += frameBytes;
+    } else {
+        // Runs of (unchanged count, changed count, changed bytes XOR the
+        // previous frame). Nothing at all if the frame didn't change.
+        uint32_t pos = 0;
+        while (pos < frameBytes) {
+            uint32_t skip = pos;
+            while (pos < frameBytes && pixels[pos] == prev[pos])
+                pos++;
+            if (pos == frameBytes)
+                break;
+            uint32_t run = pos;
+            while (pos < frameBytes && pixels[pos] != prev[pos])
+                pos++;
+
+            len += putVarint(scratch + len, run - skip);
+            len += putVarint(scratch + len, pos - run);
+            for (uint32_t i = run; i < pos; i++)
+                scratch[len++] = pixels[i] ^ prev[i];
+        }
+    }
+    memcpy(prev, pixels, frameBytes);
+
+    scratch[flagPos] = flags;
+    scratch[0] = (len - 2) & 0xff;
+    scratch[1] = (len - 2) >> 8;
+
+    while (RecorderBytes - store.used < len)
+        dropOldest();
+    push(scratch, len);
+    store.frames++;
+
+    uint32_t cost = micros() - start;
+    store.costTotal += cost;
+    store.costFrames++;
+    if (cost > store.costMax)
+        store.costMax = cost;
+}
+
+void recorderDump(Print& out)
+{
+    out.printf("flight begin frames=%u bytes=%u framebytes=%u\n",
+        unsigned(store.frames), unsigned(store.used),
+        unsigned(store.frameBytes));
+    if (store.costFrames)
+        out.printf("flight cost avg=%uus max=%uus\n",
+            unsigned(store.costTotal / store.costFrames),
+            unsigned(store.costMax));
+
+    // Skip ahead to the first keyframe, since nothing before it can be
+    // decoded.
+    uint32_t pos = store.tail;
+    uint32_t left = store.used;
+    bool started = false;
+    while (left > 0) {
+        uint32_t len = peek(pos) | (peek(pos + 1) << 8);
+        if (!started)
+            started = peek(pos + 2) & flagKey;
+        if (started) {
+            for (uint32_t i = 0; i < len; i++)
+                out.printf("%02x", peek(pos + 2 + i));
+            out.print("\n");
+        }
+        pos = (pos + 2 + len) % RecorderBytes;
+        left -= 2 + len;
+    }
+    out.print("flight end\n");
+}
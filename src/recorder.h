@@ -0,0 +1,46 @@
+#pragma once
+#include <Arduino.h>
+
+// The flight recorder keeps the last few hundred frames in RAM, along with
+// when they were shown, which mode drew them and any input that arrived, so
+// there's something to look at when a lamp "glitched".
+//
+// Frames are stored as the bytes that changed since the previous frame, with
+// a full keyframe every RecorderKeyInterval frames so the oldest records can
+// be dropped as new ones arrive. The buffer lives in memory that isn't
+// cleared on a reset, so after a crash or a watchdog reset the frames leading
+// up to it can still be dumped. tools/flightdump.py decodes a dump.
+
+// Bytes of history. At 24 pixels a quiet frame takes a handful of bytes and a
+// busy one a few dozen.
+const size_t RecorderBytes = 12 * 1024;
+// Largest frame the recorder takes, in bytes, so that the buffer still holds
+// a few keyframes. A ring and a 16x16 panel come to 1120.
+const size_t RecorderMaxFrame = RecorderBytes / 4;
+const uint16_t RecorderKeyInterval = 64;
+
+// Input events, ORed together into the next recorded frame.
+const uint8_t RecorderEventSwitch = 0x01;
+const uint8_t RecorderEventSerial = 0x02;
+// Marks the first frame after a reset. Its time counts from the reset, not
+// from the frame before, since the clock starts over.
+const uint8_t RecorderEventReset = 0x04;
+
+// recorderBegin sets the recorder up for frames of frameBytes bytes. If the
+// buffer still holds a valid recording from before the last reset, it's kept
+// and recorderBegin returns true.
+bool recorderBegin(size_t frameBytes);
+// recorderRecording is false if frames are too big to record, or there
+// wasn't the memory to.
+bool recorderRecording();
+
+// recorderMode notes which mode is drawing the frames that follow.
+void recorderMode(uint8_t mode);
+void recorderEvent(uint8_t event);
+
+// recorderFrame adds a frame shown at time ms.
+void recorderFrame(uint32_t ms, const uint8_t* pixels);
+
+// recorderDump writes the recording to out as hex, oldest frame first, along
+// with what recording has cost per frame.
+void recorderDump(Print& out);
@@ -0,0 +1,24 @@
+#include "rng.h"
+
+static uint32_t state = 2463534242u;
+
+void rngSeed(uint32_t seed)
+{
+    // xorshift never leaves zero.
+    state = seed ? seed : 2463534242u;
+}
+
+uint32_t rngNext()
+{
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+uint32_t rngState()
+{
+    return state;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+
+// The lamp's own random numbers, for everything that ends up on the pixels.
+//
+// Arduino's random() reads the hardware RNG on some ESP32 cores whatever
+// randomSeed() was given, so nothing drawn with it can be repeated. This is
+// a xorshift32 generator instead: seeded from the hardware at boot, so the
+// lamp still never does the same thing twice, and reseeded by offline
+// renders, so the same mode, seed and clock always draw the same frames.
+
+void rngSeed(uint32_t seed);
+uint32_t rngNext();
+// rngState is where the generator has got to. Seeding with it carries on
+// from there.
+uint32_t rngState();
+
+// rngRandom returns a number from 0 to howbig - 1, like random(howbig).
+inline long rngRandom(long howbig)
+{
+    return howbig > 0 ? long(rngNext() % uint32_t(howbig)) : 0;
+}
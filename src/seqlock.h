@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <string.h>
+#include <stdint.h>
+
+// seqlock publishes a block of parameters from a control task to the render
+// loop without either side ever blocking.
+//
+// A writer bumps the sequence number to odd, copies the new block in and
+// bumps it back to even. A reader copies the block out and checks the
+// sequence number didn't move while it did, trying again if it did, so it
+// can never see half of one update and half of another. Readers keep the
+// last version they saw, so on frames where nothing was published a read is
+// a single atomic load.
+//
+// Writers claim the block with a compare and swap, so any number of tasks
+// can publish. T has to be plain data. It's stored as atomic words so the
+// copies themselves are never a data race.
+template<typename T>
+class seqlock
+{
+public:
+    seqlock() : seq(0)
+    {
+        for (auto& w : words)
+            w.store(0, std::memory_order_relaxed);
+    }
+
+    void publish(const T& value)
+    {
+        uint32_t buf[wordCount] = {};
+        memcpy(buf, &value, sizeof(T));
+
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        while (true) {
+            if (s & 1) {
+                s = seq.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (seq.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                                          std::memory_order_relaxed))
+                break;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < wordCount; i++)
+            words[i].store(buf[i], std::memory_order_relaxed);
+
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    // read copies the latest block into out if it's newer than version, and
+    // updates version. It returns false, having only looked at the sequence
+    // number, if nothing has been published since.
+    bool read(T& out, uint32_t& version) const
+    {
+        uint32_t s = seq.load(std::memory_order_acquire);
+        if (s == version)
+            return false;
+
+        uint32_t buf[wordCount];
+        while (true) {
+            if (s & 1) {
+                s = seq.load(std::memory_order_acquire);
+                continue;
+            }
+
+            for (size_t i = 0; i < wordCount; i++)
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            uint32_t again = seq.load(std::memory_order_relaxed);
+            if (again == s)
+                break;
+            s = again;
+        }
+
+        memcpy(&out, buf, sizeof(T));
+        version = s;
+        return true;
+    }
+
+private:
+    static const size_t wordCount = (sizeof(T) + 3) / 4;
+
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> words[wordCount];
+};
@@ -0,0 +1,30 @@
+#include <string.h>
+#include "snapshot.h"
+#include "checksum.h"
+
+void snapshotWrite(snapshotHeader& out, uint8_t* data, uint16_t maxData,
+                   const void* state, uint16_t size)
+{
+    if (size > maxData)
+        size = 0;
+
+    memcpy(out.magic, "LSNP", 4);
+    out.version = SnapshotVersion;
+    out.size = size;
+    if (size)
+        memcpy(data, state, size);
+    out.crc = frameCrc(0, data, size);
+}
+
+bool snapshotRead(const snapshotHeader& in, const uint8_t* data,
+                  uint16_t maxData, void* state, uint16_t size)
+{
+    if (memcmp(in.magic, "LSNP", 4) != 0 || in.version != SnapshotVersion ||
+        in.size != size || size > maxData ||
+        frameCrc(0, data, size) != in.crc)
+        return false;
+
+    if (size)
+        memcpy(state, data, size);
+    return true;
+}
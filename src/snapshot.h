@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Snapshots of a running mode, so it can carry on from where it was instead
+// of starting over from setup(): after a deep sleep, a config reload, on
+// another lamp, or from a point in a flight recorder replay.
+//
+// A snapshot is a small header followed by the mode's own state, which each
+// mode keeps as a plain struct and copies in whole. Times in it are relative
+// to the frame the snapshot was taken on, so it can be restored against any
+// frame clock. SnapshotVersion goes up whenever any mode's struct changes,
+// and a snapshot from another version is turned down, along with one for
+// another mode or one that fails its CRC.
+//
+// How much room the state needs depends on the modes built in and how many
+// pixels they have, so main.cpp sizes its modeSnapshot from the biggest
+// mode's struct, as a snapshotOf that size.
+
+const uint8_t SnapshotVersion = 2;
+
+struct snapshotHeader
+{
+    char magic[4];  // "LSNP"
+    uint8_t version;
+    // Which of the modes took it.
+    uint8_t mode;
+    uint16_t size;
+    // frameCrc of the data.
+    uint32_t crc;
+};
+
+// A snapshot with room for MaxData bytes of state.
+template<uint16_t MaxData>
+struct snapshotOf : snapshotHeader
+{
+    uint8_t data[MaxData];
+};
+
+// snapshotWrite fills in out with size bytes of state, in data, which has
+// room for maxData. The mode is left for the caller.
+void snapshotWrite(snapshotHeader& out, uint8_t* data, uint16_t maxData,
+                   const void* state, uint16_t size);
+
+// snapshotRead copies the state out of in, if it's a sound snapshot of
+// this version and exactly size bytes long.
+bool snapshotRead(const snapshotHeader& in, const uint8_t* data,
+                  uint16_t maxData, void* state, uint16_t size);
+
+// snapshotBytes is how much of a snapshot needs to be kept or sent.
+inline size_t snapshotBytes(const snapshotHeader& s)
+{
+    return sizeof(snapshotHeader) + s.size;
+}
+
+template<uint16_t MaxData>
+void snapshotWrite(snapshotOf<MaxData>& out, const void* state, uint16_t size)
+{
+    snapshotWrite(out, out.data, MaxData, state, size);
+}
+
+template<uint16_t MaxData>
+bool snapshotRead(const snapshotOf<MaxData>& in, void* state, uint16_t size)
+{
+    return snapshotRead(in, in.data, MaxData, state, size);
+}
+
+template<uint16_t MaxData, typename T>
+void snapshotPut(snapshotOf<MaxData>& out, const T& state)
+{
+    static_assert(sizeof(T) <= MaxData, "snapshot state too big");
+    snapshotWrite(out, out.data, MaxData, &state, sizeof(T));
+}
+
+template<uint16_t MaxData, typename T>
+bool snapshotGet(const snapshotOf<MaxData>& in, T& state)
+{
+    return snapshotRead(in, in.data, MaxData, &state, sizeof(T));
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// spscQueue passes items from one task to another without locks. There must
+// be only one task pushing and one popping. It holds N - 1 items, and N must
+// be a power of two. Nothing is allocated; push just fails when it's full.
+template<typename T, size_t N>
+class spscQueue
+{
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+    bool push(const T& item)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t next = (h + 1) & (N - 1);
+        if (next == tail.load(std::memory_order_acquire))
+            return false;
+
+        items[h] = item;
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+
+        item = items[t];
+        tail.store((t + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    T items[N];
+};
@@ -0,0 +1,105 @@
+#ifdef VIEWER
+#ifdef ARDUINO
+#error "VIEWER is for host builds; the ESP32 has no shared memory to publish to"
+#endif
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "viewer.h"
+
+static viewerHeader* header;
+static uint8_t* slots;
+static size_t slotBytes;
+static size_t frameSize;
+
+// Publishing cost, in ns.
+static uint64_t spentNs;
+static uint64_t worstNs;
+
+static uint64_t nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
+
+bool viewerBegin(const char* name, size_t frameBytes, uint16_t panelWidth,
+                 uint16_t panelHeight)
+{
+    // Slots are kept 8 byte aligned, so the sequence numbers are too.
+    slotBytes = (sizeof(viewerSlot) + frameBytes + 7) & ~size_t(7);
+    size_t size = sizeof(viewerHeader) + slotBytes * ViewerSlots;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return false;
+    }
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+        return false;
+
+    memset(mem, 0, size);
+    header = static_cast<viewerHeader*>(mem);
+    slots = static_cast<uint8_t*>(mem) + sizeof(viewerHeader);
+    frameSize = frameBytes;
+
+    header->version = ViewerVersion;
+    header->slots = ViewerSlots;
+    header->frameBytes = frameBytes;
+    header->panelWidth = panelWidth;
+    header->panelHeight = panelHeight;
+    // The magic goes in last, so a viewer never sees half a header.
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = ViewerMagic;
+    return true;
+}
+
+void viewerFrame(uint32_t ms, const uint8_t* pixels, uint16_t ringPixels)
+{
+    if (!header)
+        return;
+    uint64_t start = nowNs();
+
+    uint32_t frame = header->written.load(std::memory_order_relaxed);
+    // If the viewer hasn't read the frame that used to be in this slot,
+    // it's lost. Until a viewer has read anything, there's nobody to lose
+    // frames.
+    uint32_t read = header->readUpTo.load(std::memory_order_relaxed);
+    if (read && frame - read >= ViewerSlots)
+        header->dropped.fetch_add(1, std::memory_order_relaxed);
+
+    viewerSlot* slot = reinterpret_cast<viewerSlot*>(
+        slots + (frame % ViewerSlots) * slotBytes);
+    slot->sequence.store(2 * frame + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->ms = ms;
+    slot->ringPixels = ringPixels;
+    memcpy(reinterpret_cast<uint8_t*>(slot + 1), pixels, frameSize);
+    slot->sequence.store(2 * (frame + 1), std::memory_order_release);
+    header->written.store(frame + 1, std::memory_order_release);
+
+    uint64_t spent = nowNs() - start;
+    spentNs += spent;
+    if (spent > worstNs)
+        worstNs = spent;
+}
+
+void viewerReport(Print& out)
+{
+    if (!header) {
+        out.printf("viewer off\n");
+        return;
+    }
+    uint32_t written = header->written.load(std::memory_order_relaxed);
+    out.printf("viewer: %u frames, %u dropped, %.0f ns/frame, worst %u ns\n",
+        unsigned(written), unsigned(header->dropped.load()),
+        written ? double(spentNs) / written : 0.0, unsigned(worstNs));
+}
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Live viewer output for the host build, built in when VIEWER is defined:
+//
+//   make -C test viewer
+//   test/build/viewer --live 2 &
+//   python tools/viewer.py
+//
+// Every frame shown is published into a ring of ViewerSlots frames in POSIX
+// shared memory (/dev/shm/<name>), where tools/viewer.py, or anything else
+// that knows the layout below, can pick it up. The lamp never waits for the
+// viewer: if it falls a whole ring behind, the oldest frame it hasn't read is
+// overwritten and counted as dropped.
+//
+// Each slot has a sequence number that's odd while the slot is being written
+// and 2 * (frame + 1) once frame is in it. A reader reads the sequence, then
+// the frame, then the sequence again, and only keeps the frame if the two
+// match. It tells the lamp how far it's got through readUpTo.
+
+const uint32_t ViewerMagic = 0x5257564c;  // "LVWR"
+const uint16_t ViewerVersion = 1;
+const uint16_t ViewerSlots = 8;
+
+struct viewerHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slots;
+    uint32_t frameBytes;
+    // The panel after the ring, if there is one.
+    uint16_t panelWidth;
+    uint16_t panelHeight;
+    // Frames published so far.
+    std::atomic<uint32_t> written;
+    // Frames the viewer has finished with. Only the viewer writes this.
+    std::atomic<uint32_t> readUpTo;
+    // Frames overwritten before the viewer got to them.
+    std::atomic<uint32_t> dropped;
+    uint32_t reserved;
+};
+
+struct viewerSlot
+{
+    std::atomic<uint32_t> sequence;
+    uint32_t ms;
+    // Ring pixels fitted when the frame was drawn; the panel starts here.
+    uint16_t ringPixels;
+    uint16_t reserved;
+    uint32_t reserved2;
+    // frameBytes of pixels in wire order follow.
+};
+
+#ifdef VIEWER
+#include <Print.h>
+
+// The shared memory's name. Tests use their own, so as not to get in the
+// way of a lamp somebody is watching.
+#ifndef VIEWER_NAME
+#define VIEWER_NAME "/lamp"
+#endif
+
+// viewerBegin creates the shared memory for frames of frameBytes bytes.
+bool viewerBegin(const char* name, size_t frameBytes, uint16_t panelWidth,
+                 uint16_t panelHeight);
+// viewerFrame publishes a frame. It never blocks.
+void viewerFrame(uint32_t ms, const uint8_t* pixels, uint16_t ringPixels);
+// viewerReport prints how many frames went out, how many the viewer missed,
+// and what publishing them cost.
+void viewerReport(Print& out);
+#endif
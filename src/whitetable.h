@@ -0,0 +1,59 @@
+// Generated by tools/whitetable.py, don't edit by hand.
+//
+// R, G, B, W mix for each color temperature from 2200K to 6500K in 100K
+// steps, assuming a 4000K white die.
+#pragma once
+#include "hot.h"
+
+const uint16_t WhiteDieKelvin = 4000;
+const uint16_t WhiteMinKelvin = 2200;
+const uint16_t WhiteMaxKelvin = 6500;
+const uint16_t WhiteStepKelvin = 100;
+
+// modeLight reads this every frame while it changes temperature.
+LAMP_HOT_DATA const uint8_t whiteTable[][4] = {
+    {255, 128,   0,  79}, // 2200K
+    {255, 127,   0, 111}, // 2300K
+    {255, 126,   0, 146}, // 2400K
+    {255, 125,   0, 186}, // 2500K
+    {255, 124,   0, 231}, // 2600K
+    {230, 111,   0, 255}, // 2700K
+    {189,  91,   0, 255}, // 2800K
+    {157,  75,   0, 255}, // 2900K
+    {130,  62,   0, 255}, // 3000K
+    {108,  51,   0, 255}, // 3100K
+    { 89,  42,   0, 255}, // 3200K
+    { 73,  34,   0, 255}, // 3300K
+    { 58,  27,   0, 255}, // 3400K
+    { 46,  21,   0, 255}, // 3500K
+    { 35,  16,   0, 255}, // 3600K
+    { 25,  11,   0, 255}, // 3700K
+    { 16,   7,   0, 255}, // 3800K
+    {  7,   3,   0, 255}, // 3900K
+    {  0,   0,   0, 255}, // 4000K
+    {  0,   2,   5, 255}, // 4100K
+    {  0,   5,   9, 255}, // 4200K
+    {  0,   7,  13, 255}, // 4300K
+    {  0,   9,  17, 255}, // 4400K
+    {  0,  12,  21, 255}, // 4500K
+    {  0,  14,  25, 255}, // 4600K
+    {  0,  16,  29, 255}, // 4700K
+    {  0,  18,  33, 255}, // 4800K
+    {  0,  20,  36, 255}, // 4900K
+    {  0,  22,  40, 255}, // 5000K
+    {  0,  24,  43, 255}, // 5100K
+    {  0,  26,  47, 255}, // 5200K
+    {  0,  28,  50, 255}, // 5300K
+    {  0,  30,  53, 255}, // 5400K
+    {  0,  32,  56, 255}, // 5500K
+    {  0,  33,  59, 255}, // 5600K
+    {  0,  35,  62, 255}, // 5700K
+    {  0,  37,  65, 255}, // 5800K
+    {  0,  39,  68, 255}, // 5900K
+    {  0,  40,  71, 255}, // 6000K
+    {  0,  42,  74, 255}, // 6100K
+    {  0,  44,  76, 255}, // 6200K
+    {  0,  45,  79, 255}, // 6300K
+    {  0,  47,  81, 255}, // 6400K
+    {  0,  48,  84, 255}, // 6500K
+};
@@ -0,0 +1,128 @@
+// Feeds ambientFilter traces of sensor readings like the ones a room gives:
+// steady light with noise on it, lights going on and off, and dusk.
+
+#include <stdlib.h>
+#include <vector>
+#include "ambient.h"
+#include "check.h"
+
+// noisy returns count readings around level, up to spread either side, from
+// a fixed sequence so every run sees the same trace.
+static std::vector<uint16_t> noisy(uint16_t level, int spread, int count)
+{
+    static uint32_t state = 12345;
+    std::vector<uint16_t> trace;
+    for (int i = 0; i < count; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        int r = int(level) + int(state % (2 * spread + 1)) - spread;
+        trace.push_back(r < 0 ? 0 : r > 4095 ? 4095 : r);
+    }
+    return trace;
+}
+
+// run feeds trace to f, and returns the brightness after every reading.
+static std::vector<uint8_t> run(ambientFilter& f,
+                                const std::vector<uint16_t>& trace)
+{
+    std::vector<uint8_t> out;
+    for (uint16_t r : trace)
+        out.push_back(f.add(r));
+    return out;
+}
+
+// largestStep returns the largest change from one reading to the next.
+static int largestStep(uint8_t from, const std::vector<uint8_t>& out)
+{
+    int largest = 0;
+    for (uint8_t b : out) {
+        largest = abs(int(b) - int(from)) > largest ? abs(int(b) - int(from))
+                                                    : largest;
+        from = b;
+    }
+    return largest;
+}
+
+// reversals returns how many times the brightness changed direction.
+static int reversals(const std::vector<uint8_t>& out)
+{
+    int count = 0, last = 0;
+    for (size_t i = 1; i < out.size(); i++) {
+        int dir = out[i] > out[i - 1] ? 1 : out[i] < out[i - 1] ? -1 : 0;
+        if (dir && last && dir != last)
+            count++;
+        if (dir)
+            last = dir;
+    }
+    return count;
+}
+
+int main()
+{
+    ambientFilter f;
+
+    // The curve: never off in the dark, full on in daylight, and straight
+    // lines in between.
+    f.reset(0);
+    CHECK(f.brightness() == 24);
+    f.reset(150);
+    CHECK(f.brightness() == 24);
+    f.reset(1200);
+    CHECK(f.brightness() == 148);
+    f.reset(4095);
+    CHECK(f.brightness() == 255);
+
+    // A steady room with sensor noise on it: the brightness stays put,
+    // near a step in the curve or not.
+    const uint16_t rooms[] = {100, 600, 1000, 1800, 2600};
+    for (uint16_t room : rooms) {
+        f.reset(room);
+        uint8_t start = f.brightness();
+        auto out = run(f, noisy(room, 60, 2000));
+        CHECK(largestStep(start, out) == 0);
+    }
+
+    // Lights on: the brightness climbs a step per reading, never backs
+    // off, and ends up where the curve says.
+    f.reset(100);
+    auto on = run(f, noisy(2400, 20, 600));
+    CHECK(largestStep(24, on) <= 1);
+    CHECK(reversals(on) == 0);
+    f.reset(2400);
+    uint8_t bright = f.brightness();
+    CHECK(abs(int(on.back()) - int(bright)) <= 2);
+
+    // And off again.
+    f.reset(2400);
+    auto off = run(f, noisy(100, 20, 600));
+    CHECK(largestStep(bright, off) <= 1);
+    CHECK(reversals(off) == 0);
+    CHECK(off.back() == 24);
+
+    // Dusk: the light falls slowly with noise on it. The lamp follows it
+    // down in a few fades, without hunting back up.
+    f.reset(2400);
+    std::vector<uint16_t> dusk;
+    for (int level = 2400; level > 100; level -= 2) {
+        auto n = noisy(level, 40, 1);
+        dusk.push_back(n[0]);
+    }
+    auto down = run(f, dusk);
+    CHECK(largestStep(bright, down) <= 1);
+    CHECK(reversals(down) == 0);
+    CHECK(down.back() <= 24 + 12);
+
+    // A flash, a car's headlights, say: the lamp starts to follow it, a
+    // step at a time, and comes back to within the hysteresis band of
+    // where it was.
+    f.reset(300);
+    uint8_t before = f.brightness();
+    auto flash = noisy(300, 10, 80);
+    flash[20] = flash[21] = 4095;
+    auto out = run(f, flash);
+    CHECK(largestStep(before, out) <= 1);
+    CHECK(abs(int(out.back()) - int(before)) <= 12);
+
+    return checkDone("ambient");
+}
@@ -0,0 +1,70 @@
+// Runs the output stage's calibration pass at every brightness, with and
+// without a calibration matrix. Plain brightness goes through the pixel
+// kernels' table lookup instead of the matrix, and has to come out exactly
+// as the matrix would have it.
+
+#include <string.h>
+#include "calibration.h"
+#include "rng.h"
+#include "check.h"
+
+static const size_t Pixels = 37;
+
+// matrixPass is the calibration pass done the long way.
+static void matrixPass(const colorCalibration& cal, const uint8_t* src,
+                       uint8_t* dst)
+{
+    for (size_t i = 0; i < Pixels * 4; i += 4)
+        for (int row = 0; row < 4; row++) {
+            int32_t v = 0;
+            for (int col = 0; col < 4; col++)
+                v += cal.matrix[row][col] * src[i + col];
+            v = (v + CalibrationOne / 2) >> 12;
+            dst[i + row] = v < 0 ? 0 : (v > 255 ? 255 : v);
+        }
+}
+
+int main()
+{
+    uint8_t src[Pixels * 4];
+    for (size_t i = 0; i < sizeof(src); i++)
+        src[i] = i < 256 ? i : rngRandom(256);
+
+    const int16_t rgbw[4][4] = {
+        {3900, 150, 50, 0},
+        {100, 3950, 50, 0},
+        {50, 100, 4000, 0},
+        {0, 0, 0, 3800},
+    };
+    const uint8_t order[4] = {1, 0, 2, 3};
+    colorCalibration plain, fixture;
+    resetCalibration(plain, nullptr);
+    resetCalibration(fixture, nullptr);
+    setCalibrationMatrix(fixture, rgbw, order);
+    CHECK(plain.identity && plain.uniform);
+    CHECK(!fixture.identity && !fixture.uniform);
+
+    int wrong = 0, uniform = 0;
+    for (int level = 0; level < 256; level++) {
+        colorCalibration out;
+        uint8_t got[Pixels * 4], want[Pixels * 4];
+
+        scaleCalibration(plain, level, out);
+        uniform += out.uniform;
+        applyCalibration(out, src, got, Pixels);
+        matrixPass(out, src, want);
+        wrong += memcmp(got, want, sizeof(got)) != 0;
+
+        scaleCalibration(fixture, level, out);
+        uniform += out.uniform && level;
+        applyCalibration(out, src, got, Pixels);
+        matrixPass(out, src, want);
+        wrong += memcmp(got, want, sizeof(got)) != 0;
+    }
+    CHECK(wrong == 0);
+    // Every brightness of the plain one, and none of the fixture's but 0,
+    // where its matrix is all zeros.
+    CHECK(uniform == 256);
+
+    return checkDone("calibration");
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <stdio.h>
+
+// What the host tests check with. A failed CHECK is reported and the test
+// carries on, so one run shows everything that's wrong; checkDone ends the
+// test with the exit status make looks at.
+
+static int checkFailures = 0;
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,    \
+                   #cond);                                             \
+            checkFailures++;                                           \
+        }                                                              \
+    } while (0)
+
+inline int checkDone(const char* name)
+{
+    printf("%s: %s\n", name, checkFailures ? "FAILED" : "ok");
+    return checkFailures ? 1 : 0;
+}
@@ -0,0 +1,149 @@
+// Checks the frame CRCs against zlib's CRC-32, and that the lines a render
+// with checksums on sends are the CRCs of the frames it would have sent,
+// taken after brightness as the live lamp's are.
+
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "calibration.h"
+#include "checksum.h"
+#include "check.h"
+
+void setup();
+void checkSerial();
+void runMode(int mode);
+void setBrightness(uint8_t level);
+
+extern uint32_t frameMillis;
+
+// The frames the lamp has shown, and their CRC.
+static unsigned shows;
+static uint32_t shownCrc;
+
+static void shown(const uint8_t* pixels, size_t size)
+{
+    shows++;
+    shownCrc = frameCrc(shownCrc, pixels, size);
+}
+
+struct line
+{
+    unsigned second;
+    unsigned frames;
+    uint32_t crc;
+};
+
+// lines returns the crc lines in out.
+static std::vector<line> lines(const std::string& out)
+{
+    std::vector<line> found;
+    size_t at = 0;
+    while ((at = out.find("\ncrc ", at)) != std::string::npos) {
+        line l;
+        at++;
+        if (sscanf(out.c_str() + at, "crc %u %u %x", &l.second, &l.frames,
+                   &l.crc) == 3)
+            found.push_back(l);
+    }
+    return found;
+}
+
+static std::string command(const char* text)
+{
+    Serial.output.clear();
+    Serial.input = text;
+    Serial.readAt = 0;
+    checkSerial();
+    return Serial.output;
+}
+
+int main()
+{
+    // zlib.crc32(b'123456789'), and carrying on from one call to the next.
+    const uint8_t digits[] = "123456789";
+    CHECK(frameCrc(0, digits, 9) == 0xcbf43926);
+    CHECK(frameCrc(frameCrc(0, digits, 4), digits + 4, 5) == 0xcbf43926);
+    CHECK(frameCrc(0, digits, 0) == 0);
+
+    // Frames every 20ms for two and a half seconds come out as a line a
+    // second, the last one when it's flushed.
+    checksumEnable(true);
+    uint8_t frame[96];
+    uint32_t expect[3] = {};
+    for (uint32_t ms = 0; ms < 2500; ms += 20) {
+        for (size_t i = 0; i < sizeof(frame); i++)
+            frame[i] = ms + i;
+        expect[ms / 1000] = frameCrc(expect[ms / 1000], frame, sizeof(frame));
+        checksumFrame(ms, frame, sizeof(frame), Serial);
+    }
+    CHECK(lines("\n" + Serial.output).size() == 2);
+    checksumFlush(Serial);
+    auto seconds = lines("\n" + Serial.output);
+    CHECK(seconds.size() == 3);
+    for (size_t s = 0; s < seconds.size() && s < 3; s++) {
+        CHECK(seconds[s].second == s);
+        CHECK(seconds[s].frames == (s < 2 ? 50u : 25u));
+        CHECK(seconds[s].crc == expect[s]);
+    }
+    checksumEnable(false);
+
+    // A render with checksums on sends the CRCs of the frames a render
+    // with them off sends, and ends the same way.
+    setup();
+    std::string frames = command("r 2 3 20 1 7 0\n");
+    command("c");
+    std::string crcs = command("r 2 3 20 1 7 0\n");
+    command("c");
+    const size_t frameBytes = 24 * 4;
+    size_t begin = frames.find('\n') + 1;
+    size_t end = frames.rfind("render end");
+    CHECK(end - begin == 150 * frameBytes);
+    seconds = lines(crcs);
+    CHECK(seconds.size() == 3);
+    for (size_t s = 0; s < seconds.size() && s < 3; s++) {
+        const uint8_t* data = (const uint8_t*)frames.data() + begin +
+                              s * 50 * frameBytes;
+        CHECK(seconds[s].frames == 50);
+        CHECK(seconds[s].crc == frameCrc(0, data, 50 * frameBytes));
+    }
+    CHECK(frames.substr(frames.rfind("crc=")) ==
+          crcs.substr(crcs.rfind("crc=")));
+
+    // Dimmed, the CRCs are of the frames as they go out, which is what the
+    // live lamp checksums, rather than of what the mode drew.
+    setBrightness(100);
+    command("c");
+    crcs = command("r 2 3 20 1 7 0\n");
+    command("c");
+    hostShow = shown;
+    colorCalibration cal, dimmed;
+    resetCalibration(cal, nullptr);
+    scaleCalibration(cal, 100, dimmed);
+    std::vector<uint8_t> out(50 * frameBytes);
+    seconds = lines(crcs);
+    CHECK(seconds.size() == 3);
+    for (size_t s = 0; s < seconds.size() && s < 3; s++) {
+        const uint8_t* data = (const uint8_t*)frames.data() + begin +
+                              s * 50 * frameBytes;
+        applyCalibration(dimmed, data, out.data(), 50 * 24);
+        CHECK(seconds[s].crc == frameCrc(0, out.data(), out.size()));
+        CHECK(seconds[s].crc != frameCrc(0, data, 50 * frameBytes));
+    }
+
+    // The live lamp, dimmed the same, checksums what it shows.
+    Serial.output.clear();
+    checksumEnable(true);
+    for (uint32_t ms = 5000; ms < 6000; ms += 20) {
+        frameMillis = ms;
+        runMode(2);
+    }
+    checksumFlush(Serial);
+    checksumEnable(false);
+    seconds = lines("\n" + Serial.output);
+    CHECK(shows > 0);
+    CHECK(seconds.size() == 1 && seconds[0].frames == shows &&
+          seconds[0].crc == shownCrc);
+
+    return checkDone("checksum");
+}
@@ -0,0 +1,88 @@
+// Parses configs, good and bad. A config with any value that's malformed,
+// too long or out of its field's range is refused as a whole.
+
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "check.h"
+
+static const lampConfig base = {
+    15000, 200, 20000, 128, 0.3f, 24, 255, 4000, 0, 0, 60000, 0};
+
+static lampConfig parsed;
+
+// parse feeds text to a parser started from base, and returns its error, or
+// nullptr if the config parsed.
+static const char* parse(const char* text)
+{
+    configParser parser;
+    parser.begin(base);
+    configStatus status = configMore;
+    for (const char* c = text; *c && status == configMore; c++)
+        status = parser.feed(*c);
+    if (status != configDone)
+        return parser.error() ? parser.error() : "unfinished";
+    parsed = parser.result();
+    return nullptr;
+}
+
+static bool refused(const char* text, const char* why)
+{
+    const char* err = parse(text);
+    return err && !strcmp(err, why);
+}
+
+int main()
+{
+    configPixelLimit(24);
+
+    CHECK(parse("{}") == nullptr);
+    CHECK(parse("{\"fadeDelay\": 8000, \"luminance\": 0.25, \"kelvin\": 2700,"
+                " \"fadeWander\": 100, \"pixelCount\": 24}") == nullptr);
+    CHECK(parsed.fadeDelay == 8000 && parsed.luminance == 0.25f &&
+          parsed.kelvin == 2700 && parsed.fadeWander == 100 &&
+          parsed.pixelCount == 24 && parsed.rotateDelay == base.rotateDelay);
+
+    // Long numbers: a fraction just loses the digits a float can't use, a
+    // whole number is an error rather than something else.
+    CHECK(parse("{\"luminance\": 0.123456789012345}") == nullptr);
+    CHECK(fabsf(parsed.luminance - 0.12345679f) < 1e-6f);
+    CHECK(parse("{\"fadeDelay\": 000000000000008}") == nullptr);
+    CHECK(parsed.fadeDelay == 8);
+    CHECK(refused("{\"fadeDelay\": 1234567890}", "number too long"));
+    CHECK(refused("{\"fadeDelay\": 65536}", "value out of range"));
+    CHECK(refused("{\"luminance\": 1000000000.5}", "number too long"));
+
+    // Each field's range.
+    CHECK(refused("{\"fadeDelay\": 0}", "value out of range"));
+    CHECK(refused("{\"luminance\": 1.5}", "value out of range"));
+    CHECK(refused("{\"luminance\": -0.1}", "value out of range"));
+    CHECK(parse("{\"luminance\": 1}") == nullptr && parsed.luminance == 1.0f);
+    CHECK(refused("{\"pixelCount\": 0}", "value out of range"));
+    CHECK(refused("{\"pixelCount\": 25}", "value out of range"));
+    CHECK(refused("{\"kelvin\": 2100}", "value out of range"));
+    CHECK(refused("{\"kelvin\": 6600}", "value out of range"));
+    CHECK(refused("{\"fadeWander\": 101}", "value out of range"));
+    CHECK(refused("{\"rotateSwing\": 255}", "value out of range"));
+    CHECK(refused("{\"encoderSpeed\": 2}", "value out of range"));
+    CHECK(refused("{\"swingPeriod\": 0}", "value out of range"));
+    CHECK(refused("{\"saturation\": -1}", "expected a whole number"));
+    CHECK(refused("{\"maxBrightness\": 1.5}", "expected a whole number"));
+
+    // One bad field refuses the lot, wherever it comes.
+    parsed = base;
+    CHECK(refused("{\"fadeDelay\": 8000, \"rotateSwing\": 200}",
+                  "value out of range"));
+    CHECK(refused("{\"rotateSwing\": 200, \"fadeDelay\": 8000}",
+                  "value out of range"));
+    CHECK(parsed.fadeDelay == base.fadeDelay);
+
+    // What formatConfig writes parses back to the same config.
+    char text[300], again[300];
+    formatConfig(base, text, sizeof(text));
+    CHECK(parse(text) == nullptr);
+    formatConfig(parsed, again, sizeof(again));
+    CHECK(!strcmp(text, again));
+
+    return checkDone("config");
+}
@@ -0,0 +1,70 @@
+// Turns the host's stand-in encoder: part detents carry over to the next
+// take, either way round, and the counter wrapping at its limits doesn't
+// lose or invent a turn.
+
+#include "encoder.h"
+#include "check.h"
+
+// turn turns the knob detents detents, a frame at a time, and returns what
+// the frames took.
+static int32_t turn(int32_t detents)
+{
+    int32_t taken = 0;
+    int16_t step = detents < 0 ? -1000 : 1000;
+    while (detents) {
+        int16_t d = detents / step ? step : detents;
+        encoderTurn(d * EncoderCountsPerDetent);
+        detents -= d;
+        taken += encoderTake();
+    }
+    return taken;
+}
+
+int main()
+{
+    encoderBegin(32, 33);
+    CHECK(encoderTake() == 0);
+
+    // Clockwise, an edge at a time: a detent every fourth.
+    int taken = 0;
+    for (int i = 1; i <= 12; i++) {
+        encoderTurn(1);
+        int16_t d = encoderTake();
+        CHECK(d == (i % EncoderCountsPerDetent == 0 ? 1 : 0));
+        taken += d;
+    }
+    CHECK(taken == 3);
+
+    // Anticlockwise is negative, and several detents in a frame come out
+    // together.
+    encoderTurn(-8);
+    CHECK(encoderTake() == -2);
+
+    // Part of a detent one way and back again is nothing.
+    encoderTurn(3);
+    CHECK(encoderTake() == 0);
+    encoderTurn(-3);
+    CHECK(encoderTake() == 0);
+    encoderTurn(-1);
+    CHECK(encoderTake() == 0);
+    encoderTurn(-3);
+    CHECK(encoderTake() == -1);
+
+    // A part turn left over goes towards the next, whichever frame it
+    // finishes in.
+    encoderTurn(2);
+    CHECK(encoderTake() == 0);
+    encoderTurn(3);
+    CHECK(encoderTake() == 1);
+    encoderTurn(3);
+    CHECK(encoderTake() == 1);
+
+    // Round past the top of the counter and back past the bottom. Every
+    // detent turned is taken, in the direction it was turned.
+    CHECK(turn(9000) == 9000);
+    CHECK(turn(-20000) == -20000);
+    CHECK(turn(11000) == 11000);
+    CHECK(encoderTake() == 0);
+
+    return checkDone("encoder");
+}
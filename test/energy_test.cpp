@@ -0,0 +1,75 @@
+// Checks that the current energyFrame() keeps up to date, a pixel at a time,
+// is what summing every pixel of the frame afresh gives, as pixels change,
+// as the frame shrinks and grows, and after the power is cut.
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "energy.h"
+#include "rng.h"
+#include "check.h"
+
+static const size_t Pixels = 40;
+// NeoRgbwFeature's wire order.
+static const uint8_t order[4] = {1, 0, 2, 3};
+
+// summed works the current out from every pixel of frame.
+static uint32_t summed(const uint8_t* frame, size_t pixelCount)
+{
+    uint32_t ma = 0;
+    for (size_t p = 0; p < pixelCount; p++) {
+        const uint8_t* px = frame + p * 4;
+        ma += px[1] * milliampsR + px[0] * milliampsG + px[2] * milliampsB +
+              px[3] * milliampsW;
+    }
+    return milliampsIdle * pixelCount + ma / 255;
+}
+
+int main()
+{
+    uint8_t frame[Pixels * 4] = {};
+    uint32_t ms = 0;
+    energyBegin(ms, Pixels);
+    energyFrame(ms, frame, Pixels, order);
+    CHECK(energyMilliamps() == Pixels * milliampsIdle);
+
+    // One pixel fully lit draws what estimateMilliamps() says it does.
+    memset(frame, 255, 4);
+    energyFrame(ms += 20, frame, Pixels, order);
+    CHECK(energyMilliamps() == summed(frame, Pixels));
+    CHECK(energyMilliamps() - (Pixels - 1) * milliampsIdle ==
+          estimateMilliamps(RgbwColor(255, 255, 255, 255)));
+
+    // A few pixels changing each frame, and now and then all of them.
+    rngSeed(7);
+    int wrong = 0;
+    for (int f = 0; f < 2000; f++) {
+        int changes = f % 100 == 0 ? Pixels * 4 : rngRandom(6);
+        for (int c = 0; c < changes; c++)
+            frame[rngRandom(sizeof(frame))] = rngRandom(256);
+        energyFrame(ms += 20, frame, Pixels, order);
+        wrong += energyMilliamps() != summed(frame, Pixels);
+    }
+    CHECK(wrong == 0);
+
+    // Fewer pixels: the ones past the end stop counting, and come back as
+    // they are when the frame grows again.
+    energyFrame(ms += 20, frame, 24, order);
+    CHECK(energyMilliamps() == summed(frame, 24));
+    frame[30 * 4] ^= 0x55;
+    energyFrame(ms += 20, frame, Pixels, order);
+    CHECK(energyMilliamps() == summed(frame, Pixels));
+
+    // Cutting the power draws nothing until the next frame.
+    energyGated(ms += 20);
+    CHECK(energyMilliamps() == 0);
+    energyFrame(ms += 20, frame, Pixels, order);
+    CHECK(energyMilliamps() == summed(frame, Pixels));
+
+    // Frames bigger than accounting was started for are counted as far as
+    // it goes.
+    energyBegin(ms, 8);
+    energyFrame(ms += 20, frame, Pixels, order);
+    CHECK(energyMilliamps() == summed(frame, 8));
+
+    return checkDone("energy");
+}
@@ -0,0 +1,61 @@
+// Runs the lamp live for a few seconds of frames, switching modes and
+// restarting part way through, and writes what the flight recorder kept to
+// <this program>.log. The Makefile then has tools/flightdump.py replay the
+// recording through the host lamp, which should draw it all again exactly.
+
+#include <string>
+#include <Arduino.h>
+#include "recorder.h"
+#include "check.h"
+
+void setup();
+void runMode(int mode);
+
+extern uint32_t frameMillis;
+extern int lastMode;
+
+// run runs mode every ms, the way the loop does when nothing holds it up,
+// from frame clock start for ms ms.
+static void run(int mode, uint32_t start, uint32_t ms)
+{
+    for (uint32_t t = 0; t < ms; t++) {
+        frameMillis = start + t;
+        runMode(mode);
+    }
+}
+
+int main(int, char** argv)
+{
+    setup();
+    CHECK(recorderRecording());
+    run(2, 1000, 100);
+    run(1, 1100, 300);
+    // What's left of the lamp after it restarts, as far as the recorder and
+    // the modes are concerned.
+    setup();
+    lastMode = -1;
+    run(4, 30, 600);
+
+    Serial.output.clear();
+    recorderDump(Serial);
+    const std::string& dump = Serial.output;
+    unsigned frames = 0;
+    CHECK(sscanf(dump.c_str(), "flight begin frames=%u", &frames) == 1);
+    // The recording has to go all the way back to the first frame, for the
+    // replay to start where the lamp did.
+    CHECK(frames > 0);
+    CHECK(dump.find("flight end") != std::string::npos);
+    size_t lines = 0;
+    for (char c : dump)
+        lines += c == '\n';
+    CHECK(lines == frames + 3);
+
+    const std::string path = std::string(argv[0]) + ".log";
+    FILE* f = fopen(path.c_str(), "w");
+    CHECK(f != nullptr);
+    if (f) {
+        fwrite(dump.data(), 1, dump.size(), f);
+        fclose(f);
+    }
+    return checkDone("flight");
+}
@@ -0,0 +1,139 @@
+#pragma once
+// Just enough of the Arduino core for the lamp's sources to build and run on
+// the host, for the tests. Serial keeps whatever is written to it in output,
+// and reads from input. Nothing here defines ARDUINO, so sources with a host
+// stand-in build that instead of the hardware version.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <esp_attr.h>
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+#define PI 3.1415926535897932384626433832795
+
+unsigned long millis();
+unsigned long micros();
+inline void delay(unsigned long) {}
+inline void delayMicroseconds(unsigned int) {}
+
+// The level of each GPIO. What the lamp writes is kept here, and tests set
+// the inputs here for it to read.
+extern uint8_t hostPins[40];
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t pin) {return pin < 40 ? hostPins[pin] : LOW;}
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+    if (pin < 40)
+        hostPins[pin] = level;
+}
+inline int analogRead(uint8_t) {return 0;}
+inline uint32_t esp_random() {return 4;}
+
+// FreeRTOS, as far as the lamp uses it. Tasks never start, unless a test
+// sets hostTaskCreated to start them itself.
+extern void (*hostTaskCreated)(void (*task)(void*), void* arg);
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define pdPASS 1
+inline void vTaskDelay(TickType_t) {}
+inline void vTaskDelete(TaskHandle_t) {}
+inline int xTaskCreatePinnedToCore(void (*task)(void*), const char*, uint32_t,
+                                   void* arg, int, TaskHandle_t*, int)
+{
+    if (hostTaskCreated)
+        hostTaskCreated(task, arg);
+    return pdPASS;
+}
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+            write(buffer[i]);
+        return size;
+    }
+
+    size_t printf(const char* format, ...)
+        __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (n < 0)
+            return 0;
+        n = n < int(sizeof(buffer)) ? n : int(sizeof(buffer)) - 1;
+        return write((const uint8_t*)buffer, n);
+    }
+    size_t print(const char* s) {return write((const uint8_t*)s, strlen(s));}
+    size_t print(char c) {return write(uint8_t(c));}
+    size_t print(int n) {return printf("%d", n);}
+    size_t print(unsigned int n) {return printf("%u", n);}
+    size_t print(long n) {return printf("%ld", n);}
+    size_t print(unsigned long n) {return printf("%lu", n);}
+    size_t print(double n, int digits = 2) {return printf("%.*f", digits, n);}
+    size_t println() {return print("\r\n");}
+    template <typename T> size_t println(T value)
+    {
+        return print(value) + println();
+    }
+    void flush() {}
+};
+
+class HardwareSerial : public Print
+{
+public:
+    void begin(unsigned long) {}
+    operator bool() const {return true;}
+
+    size_t write(uint8_t c) override
+    {
+        output += char(c);
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override
+    {
+        output.append((const char*)buffer, size);
+        return size;
+    }
+    using Print::write;
+
+    int available() {return int(input.size() - readAt);}
+    int peek() {return available() ? uint8_t(input[readAt]) : -1;}
+    int read() {return available() ? uint8_t(input[readAt++]) : -1;}
+    long parseInt()
+    {
+        while (available() && peek() != '-' && (peek() < '0' || peek() > '9'))
+            read();
+        bool negative = peek() == '-';
+        if (negative)
+            read();
+        long n = 0;
+        while (peek() >= '0' && peek() <= '9')
+            n = n * 10 + read() - '0';
+        return negative ? -n : n;
+    }
+
+    std::string output;
+    std::string input;
+    size_t readAt = 0;
+};
+
+extern HardwareSerial Serial;
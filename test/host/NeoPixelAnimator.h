@@ -0,0 +1,20 @@
+#pragma once
+#include <functional>
+#include <NeoPixelBus.h>
+
+// The animation types frameAnimator shares with NeoPixelAnimator.
+enum AnimationState
+{
+    AnimationState_Started,
+    AnimationState_Progress,
+    AnimationState_Completed,
+};
+
+struct AnimationParam
+{
+    float progress;
+    uint16_t index;
+    AnimationState state;
+};
+
+typedef std::function<void(const AnimationParam& param)> AnimUpdateCallback;
@@ -0,0 +1,186 @@
+#pragma once
+// The parts of NeoPixelBus the lamp uses, for the host. Colors convert and
+// blend the way the library does, and the bus keeps its pixels in a buffer
+// in the order the library would send them, G, R, B, W for NeoRgbwFeature,
+// but Show() sends them nowhere, other than to hostShow if a test has set it.
+
+#include <Arduino.h>
+
+#define countof(array) (sizeof(array) / sizeof(array[0]))
+
+extern void (*hostShow)(const uint8_t* pixels, size_t size);
+
+struct HslColor
+{
+    HslColor(float h, float s, float l) : H(h), S(s), L(l) {}
+    float H;
+    float S;
+    float L;
+};
+
+struct RgbColor
+{
+    RgbColor(uint8_t r, uint8_t g, uint8_t b) : R(r), G(g), B(b) {}
+    RgbColor(uint8_t brightness = 0) : R(brightness), G(brightness),
+        B(brightness) {}
+    RgbColor(const HslColor& color)
+    {
+        float r, g, b;
+        if (color.S == 0.0f) {
+            r = g = b = color.L;
+        } else {
+            float q = color.L < 0.5f ? color.L * (1.0f + color.S)
+                                     : color.L + color.S - color.L * color.S;
+            float p = 2.0f * color.L - q;
+            r = hue(p, q, color.H + 1.0f / 3.0f);
+            g = hue(p, q, color.H);
+            b = hue(p, q, color.H - 1.0f / 3.0f);
+        }
+        R = uint8_t(r * 255.0f);
+        G = uint8_t(g * 255.0f);
+        B = uint8_t(b * 255.0f);
+    }
+
+    uint8_t R;
+    uint8_t G;
+    uint8_t B;
+
+private:
+    static float hue(float p, float q, float h)
+    {
+        if (h < 0.0f)
+            h += 1.0f;
+        else if (h > 1.0f)
+            h -= 1.0f;
+        if (h < 1.0f / 6.0f)
+            return p + (q - p) * 6.0f * h;
+        if (h < 0.5f)
+            return q;
+        if (h < 2.0f / 3.0f)
+            return p + (q - p) * (2.0f / 3.0f - h) * 6.0f;
+        return p;
+    }
+};
+
+struct RgbwColor
+{
+    RgbwColor(uint8_t r, uint8_t g, uint8_t b, uint8_t w = 0) :
+        R(r), G(g), B(b), W(w) {}
+    RgbwColor(uint8_t brightness = 0) : R(0), G(0), B(0), W(brightness) {}
+    RgbwColor(const RgbColor& color) :
+        R(color.R), G(color.G), B(color.B), W(0) {}
+    RgbwColor(const HslColor& color) : RgbwColor(RgbColor(color)) {}
+
+    bool operator==(const RgbwColor& other) const
+    {
+        return R == other.R && G == other.G && B == other.B && W == other.W;
+    }
+    bool operator!=(const RgbwColor& other) const {return !(*this == other);}
+
+    static RgbwColor LinearBlend(const RgbwColor& left,
+                                 const RgbwColor& right, float progress)
+    {
+        return RgbwColor(left.R + (right.R - left.R) * progress,
+                         left.G + (right.G - left.G) * progress,
+                         left.B + (right.B - left.B) * progress,
+                         left.W + (right.W - left.W) * progress);
+    }
+
+    uint8_t R;
+    uint8_t G;
+    uint8_t B;
+    uint8_t W;
+};
+
+struct NeoGammaTableMethod
+{
+    static uint8_t Correct(uint8_t value)
+    {
+        return uint8_t(255.0 * pow(value / 255.0, 1.0 / 0.45) + 0.5);
+    }
+};
+
+template <typename method> class NeoGamma
+{
+public:
+    RgbwColor Correct(const RgbwColor& color)
+    {
+        return RgbwColor(method::Correct(color.R), method::Correct(color.G),
+                         method::Correct(color.B), method::Correct(color.W));
+    }
+};
+
+struct NeoRgbwFeature
+{
+    typedef RgbwColor ColorObject;
+    static const size_t PixelSize = 4;
+
+    static void applyPixelColor(uint8_t* p, const RgbwColor& color)
+    {
+        p[0] = color.G;
+        p[1] = color.R;
+        p[2] = color.B;
+        p[3] = color.W;
+    }
+    static RgbwColor retrievePixelColor(const uint8_t* p)
+    {
+        return RgbwColor(p[1], p[0], p[2], p[3]);
+    }
+};
+
+struct NeoWs2813Method {};
+
+template <typename feature, typename method> class NeoPixelBus
+{
+public:
+    typedef typename feature::ColorObject color;
+
+    NeoPixelBus(uint16_t count, uint8_t) : count(count),
+        pixels(new uint8_t[count * feature::PixelSize]())
+    {
+    }
+    ~NeoPixelBus() {delete[] pixels;}
+
+    void Begin() {}
+    void Show()
+    {
+        if (hostShow)
+            hostShow(pixels, count * feature::PixelSize);
+        dirty = false;
+    }
+    bool CanShow() const {return true;}
+    bool IsDirty() const {return dirty;}
+    void Dirty() {dirty = true;}
+    void ResetDirty() {dirty = false;}
+
+    uint8_t* Pixels() {return pixels;}
+    size_t PixelsSize() const {return count * feature::PixelSize;}
+    size_t PixelSize() const {return feature::PixelSize;}
+    uint16_t PixelCount() const {return count;}
+
+    void SetPixelColor(uint16_t index, const color& c)
+    {
+        if (index < count) {
+            feature::applyPixelColor(pixels + index * feature::PixelSize, c);
+            dirty = true;
+        }
+    }
+    color GetPixelColor(uint16_t index) const
+    {
+        if (index >= count)
+            return color();
+        return feature::retrievePixelColor(pixels +
+                                           index * feature::PixelSize);
+    }
+    void ClearTo(const color& c) {ClearTo(c, 0, count - 1);}
+    void ClearTo(const color& c, uint16_t first, uint16_t last)
+    {
+        for (uint32_t i = first; i <= last && i < count; i++)
+            SetPixelColor(i, c);
+    }
+
+private:
+    uint16_t count;
+    uint8_t* pixels;
+    bool dirty = true;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <Arduino.h>
+
+// Flash that's always empty, and forgets whatever is put in it.
+class Preferences
+{
+public:
+    bool begin(const char*, bool = false) {return true;}
+    void end() {}
+    bool clear() {return true;}
+    bool remove(const char*) {return true;}
+    size_t getBytesLength(const char*) {return 0;}
+    size_t getBytes(const char*, void*, size_t) {return 0;}
+    size_t putBytes(const char*, const void*, size_t len) {return len;}
+    uint32_t getUInt(const char*, uint32_t value = 0) {return value;}
+    size_t putUInt(const char*, uint32_t) {return 4;}
+    size_t getString(const char*, char* value, size_t maxLen)
+    {
+        if (maxLen)
+            value[0] = 0;
+        return 0;
+    }
+    size_t putString(const char*, const char* value) {return strlen(value);}
+};
@@ -0,0 +1,54 @@
+#pragma once
+// PubSubClient, for host builds. There's no broker: it connects at once,
+// loop() hands the client whatever a test queued with hostMqttSend, and what
+// the client publishes is kept for the test to look at. Both sides may be on
+// different threads.
+
+#include <string>
+#include <vector>
+#include <WiFi.h>
+
+// hostMqttSend queues a message for the next loop() to deliver.
+void hostMqttSend(const char* topic, const char* payload);
+// hostMqttNext takes the next queued message, if there is one.
+bool hostMqttNext(std::string& topic, std::string& payload);
+// hostMqttPublish keeps a message the client published; hostMqttPublished
+// returns them all so far, as topic and payload pairs.
+void hostMqttPublish(const char* topic, const char* payload);
+std::vector<std::pair<std::string, std::string> > hostMqttPublished();
+// hostMqttWait waits a millisecond, as loop() does for the network.
+void hostMqttWait();
+
+class PubSubClient
+{
+public:
+    typedef void (*callback)(char* topic, uint8_t* payload, unsigned int len);
+
+    explicit PubSubClient(WiFiClient&) : onMessage(nullptr), up(false) {}
+
+    void setServer(const char*, uint16_t) {}
+    void setCallback(callback cb) {onMessage = cb;}
+    bool connect(const char*) {return up = true;}
+    bool connected() {return up;}
+    bool subscribe(const char*) {return true;}
+
+    bool publish(const char* topic, const char* payload)
+    {
+        hostMqttPublish(topic, payload);
+        return true;
+    }
+
+    bool loop()
+    {
+        std::string topic, payload;
+        while (hostMqttNext(topic, payload))
+            if (onMessage)
+                onMessage(&topic[0], (uint8_t*)&payload[0], payload.size());
+        hostMqttWait();
+        return true;
+    }
+
+private:
+    callback onMessage;
+    bool up;
+};
@@ -0,0 +1,19 @@
+#pragma once
+// The ESP32 WiFi library, for host builds: the host is always connected.
+
+#define WIFI_STA 1
+#define WL_CONNECTED 3
+
+class WiFiClass
+{
+public:
+    void mode(int) {}
+    void begin(const char*, const char*) {}
+    int status() {return WL_CONNECTED;}
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient
+{
+};
@@ -0,0 +1,6 @@
+#pragma once
+// On the host there's nowhere special to put anything.
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define __NOINIT_ATTR
@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// There's no flash to map on the host, so nothing is ever found.
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+typedef uint32_t spi_flash_mmap_handle_t;
+typedef enum {ESP_PARTITION_TYPE_APP = 0} esp_partition_type_t;
+typedef enum {ESP_PARTITION_SUBTYPE_ANY = 0xff} esp_partition_subtype_t;
+typedef enum {SPI_FLASH_MMAP_DATA} spi_flash_mmap_memory_t;
+typedef struct {uint32_t size;} esp_partition_t;
+
+inline const esp_partition_t* esp_partition_find_first(
+    esp_partition_type_t, esp_partition_subtype_t, const char*)
+{
+    return nullptr;
+}
+inline esp_err_t esp_partition_mmap(const esp_partition_t*, size_t, size_t,
+                                    spi_flash_mmap_memory_t, const void**,
+                                    spi_flash_mmap_handle_t*)
+{
+    return ESP_FAIL;
+}
+inline void spi_flash_munmap(spi_flash_mmap_handle_t) {}
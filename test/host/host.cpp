@@ -0,0 +1,70 @@
+// The Arduino core's globals and clock, for host builds of the lamp, and
+// the far end of the network libraries.
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include <PubSubClient.h>
+
+HardwareSerial Serial;
+uint8_t hostPins[40];
+void (*hostShow)(const uint8_t* pixels, size_t size);
+void (*hostTaskCreated)(void (*task)(void*), void* arg);
+WiFiClass WiFi;
+
+static const std::chrono::steady_clock::time_point started =
+    std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - started).count();
+}
+
+typedef std::pair<std::string, std::string> mqttMessage;
+static std::mutex mqttLock;
+static std::deque<mqttMessage> mqttQueued;
+static std::vector<mqttMessage> mqttPublished;
+
+void hostMqttSend(const char* topic, const char* payload)
+{
+    std::lock_guard<std::mutex> hold(mqttLock);
+    mqttQueued.push_back(mqttMessage(topic, payload));
+}
+
+bool hostMqttNext(std::string& topic, std::string& payload)
+{
+    std::lock_guard<std::mutex> hold(mqttLock);
+    if (mqttQueued.empty())
+        return false;
+    topic = mqttQueued.front().first;
+    payload = mqttQueued.front().second;
+    mqttQueued.pop_front();
+    return true;
+}
+
+void hostMqttPublish(const char* topic, const char* payload)
+{
+    std::lock_guard<std::mutex> hold(mqttLock);
+    mqttPublished.push_back(mqttMessage(topic, payload));
+}
+
+std::vector<mqttMessage> hostMqttPublished()
+{
+    std::lock_guard<std::mutex> hold(mqttLock);
+    return mqttPublished;
+}
+
+void hostMqttWait()
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
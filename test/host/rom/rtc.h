@@ -0,0 +1,9 @@
+#pragma once
+
+enum RESET_REASON
+{
+    NO_MEAN = 0,
+    POWERON_RESET = 1,
+};
+
+inline RESET_REASON rtc_get_reset_reason(int) {return POWERON_RESET;}
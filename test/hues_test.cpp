@@ -0,0 +1,108 @@
+// Deals hues from hueScheduler for many seeds. Each hue has to be the one
+// its sequence has next, turned by the offset and mirrored as begin() drew
+// them, at least HueMinSeparation buckets from the two before it, and each
+// pass through a sequence has to deal every hue once. begin() starts part
+// way through a sequence, so the first switch to another sequence comes
+// mid-cycle, and the separation has to hold across it and every switch
+// after.
+
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "hues.h"
+#include "rng.h"
+#include "check.h"
+
+static const int Seeds = 500;
+// Enough for a few switches of sequence.
+static const int Dealt = HueBuckets * 4;
+static const uint16_t Degrees = 360 / HueBuckets;
+
+static int distance(int a, int b)
+{
+    int d = (a - b + HueBuckets) % HueBuckets;
+    return d < HueBuckets - d ? d : HueBuckets - d;
+}
+
+int main()
+{
+    int wrongHue = 0, tooClose = 0, unevenPass = 0, passes = 0;
+    int mirrored = 0;
+    bool offsets[HueBuckets] = {};
+
+    for (int seed = 1; seed <= Seeds; seed++) {
+        // What begin() is about to draw, in the same order.
+        rngSeed(seed);
+        int sequence = rngRandom(HueSequenceCount);
+        int position = rngRandom(HueBuckets);
+        const int offset = rngRandom(HueBuckets);
+        const bool mirror = rngRandom(2);
+        mirrored += mirror;
+        offsets[offset] = true;
+
+        rngSeed(seed);
+        hueScheduler hues;
+        hues.begin();
+
+        int hue[Dealt];
+        int counts[HueBuckets] = {};
+        // Whether the pass going on started at the top of its sequence.
+        bool wholePass = false;
+        for (int i = 0; i < Dealt; i++) {
+            int h = hueSequences[sequence][position];
+            if (mirror)
+                h = (HueBuckets - h) % HueBuckets;
+            h = (h + offset) % HueBuckets;
+
+            const uint32_t state = rngState();
+            uint16_t degrees = hues.nextHue();
+            hue[i] = degrees / Degrees;
+            wrongHue += degrees != h * Degrees;
+            for (int back = 1; back <= 2 && back <= i; back++)
+                tooClose += distance(hue[i], hue[i - back]) < HueMinSeparation;
+
+            counts[hue[i]]++;
+            if (++position == HueBuckets) {
+                for (int b = 0; wholePass && b < HueBuckets; b++)
+                    unevenPass += counts[b] != 1;
+                passes += wholePass;
+                for (int b = 0; b < HueBuckets; b++)
+                    counts[b] = 0;
+                wholePass = true;
+                position = 0;
+                // The scheduler drew the next sequence here, and this
+                // draws it again.
+                rngSeed(state);
+                sequence = rngRandom(HueSequenceCount);
+            }
+        }
+    }
+    CHECK(wrongHue == 0);
+    CHECK(tooClose == 0);
+    CHECK(passes > Seeds * 2);
+    CHECK(unevenPass == 0);
+
+    // begin() reads the sequences both ways round, turned every way.
+    CHECK(mirrored > Seeds / 3 && mirrored < Seeds * 2 / 3);
+    bool everyOffset = true;
+    for (int b = 0; b < HueBuckets; b++)
+        everyOffset &= offsets[b];
+    CHECK(everyOffset);
+
+    // nextColor deals the same hues, as colors at the current luminance.
+    rngSeed(7);
+    hueScheduler hues;
+    hues.begin();
+    hues.setLuminance(0.25f);
+    hueScheduler check = hues;
+    int wrongColor = 0;
+    for (int i = 0; i < Dealt; i++) {
+        const uint32_t state = rngState();
+        float h = float(check.nextHue()) / 360;
+        rngSeed(state);
+        RgbwColor expected = HslColor(h, 1.0f, 0.25f);
+        wrongColor += hues.nextColor() != expected;
+    }
+    CHECK(wrongColor == 0);
+
+    return checkDone("hues");
+}
@@ -0,0 +1,96 @@
+// Times every kernel set this CPU can run at 1k, 100k and 1M RGBW pixels,
+// the sizes the ESP32 hasn't the memory for. The same passes as
+// benchKernels in bench.cpp, which covers the sizes a lamp has.
+//
+//   make -C test bench
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include "kernels.h"
+
+static const int benchFrames = 200;
+
+static unsigned long micros()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(
+        steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char* name, size_t pixels, unsigned long elapsed)
+{
+    float perFrame = float(elapsed) / benchFrames;
+    printf("%-24s %7u px: %9.1f us/frame %7.1f ns/px\n", name,
+        unsigned(pixels), perFrame, perFrame * 1000.0f / pixels);
+}
+
+static void benchKernels(size_t pixels)
+{
+    const size_t n = pixels * 4;
+    uint8_t* a = (uint8_t*)malloc(n);
+    uint8_t* b = (uint8_t*)malloc(n);
+    uint8_t* dst = (uint8_t*)malloc(n);
+    uint16_t* wide = (uint16_t*)malloc(n * sizeof(uint16_t));
+    if (!a || !b || !dst || !wide) {
+        printf("kernels %u px: out of memory\n", unsigned(pixels));
+        free(a);
+        free(b);
+        free(dst);
+        free(wide);
+        return;
+    }
+
+    uint8_t table[256];
+    for (int i = 0; i < 256; i++)
+        table[i] = i * i / 255;
+    for (size_t i = 0; i < n; i++) {
+        a[i] = i * 7;
+        b[i] = i * 13;
+        wide[i] = i * 1031;
+    }
+
+    const pixelKernels* variants[4];
+    size_t count = kernelVariants(variants, 4);
+    for (size_t v = 0; v < count; v++) {
+        const pixelKernels& k = *variants[v];
+        char name[32];
+
+        unsigned long start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.blend(dst, a, b, n, f);
+        snprintf(name, sizeof(name), "blend %s", k.name);
+        report(name, pixels, micros() - start);
+
+        start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.composite(dst, b, n, f);
+        snprintf(name, sizeof(name), "composite %s", k.name);
+        report(name, pixels, micros() - start);
+
+        start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.gamma(dst, a, n, table);
+        snprintf(name, sizeof(name), "gamma %s", k.name);
+        report(name, pixels, micros() - start);
+
+        start = micros();
+        for (int f = 0; f < benchFrames; f++)
+            k.dither(dst, wide, n, f);
+        snprintf(name, sizeof(name), "dither %s", k.name);
+        report(name, pixels, micros() - start);
+    }
+
+    free(a);
+    free(b);
+    free(dst);
+    free(wide);
+}
+
+int main()
+{
+    benchKernels(1000);
+    benchKernels(100000);
+    benchKernels(1000000);
+    return 0;
+}
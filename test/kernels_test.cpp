@@ -0,0 +1,103 @@
+// Checks every kernel set this CPU can run against the scalar one, over
+// lengths that leave every kind of tail, and buffers that don't start on a
+// vector boundary.
+
+#include <string.h>
+#include <vector>
+#include "kernels.h"
+#include "check.h"
+
+static uint32_t state = 12345;
+
+static uint8_t next()
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+int main()
+{
+    const pixelKernels* variants[4];
+    size_t count = kernelVariants(variants, 4);
+    CHECK(variants[0] == &scalarKernels);
+    CHECK(&bestKernels() == variants[count - 1]);
+
+    uint8_t table[256];
+    for (int i = 0; i < 256; i++)
+        table[i] = next();
+
+    const size_t lengths[] = {0, 1, 3, 4, 15, 16, 17, 31, 32, 33, 63, 64, 65,
+                              100, 127, 128, 129, 1000, 4099};
+    for (size_t n : lengths)
+        for (size_t offset = 0; offset < 3; offset++) {
+            std::vector<uint8_t> a(n + offset + 1), b(n + offset + 1);
+            std::vector<uint16_t> wide(n + offset + 1);
+            for (size_t i = 0; i < n + offset; i++) {
+                a[i] = next();
+                b[i] = next();
+                wide[i] = next() << 8 | next();
+            }
+            // The edge cases of each channel, at the start where every
+            // set sees them.
+            if (n >= 4) {
+                a[offset] = 0;
+                b[offset] = 255;
+                a[offset + 1] = 255;
+                b[offset + 1] = 0;
+                wide[offset] = 0xffff;
+                wide[offset + 1] = 0xff80;
+            }
+
+            for (unsigned t = 0; t < 256; t += 17) {
+                std::vector<uint8_t> expect(n + 1), got(n + 1);
+                const pixelKernels& s = scalarKernels;
+
+                s.blend(&expect[0], &a[offset], &b[offset], n, t);
+                for (size_t v = 1; v < count; v++) {
+                    got = b;
+                    got.resize(n + 1);
+                    got[n] = 0x5a;
+                    variants[v]->blend(&got[0], &a[offset], &b[offset], n, t);
+                    CHECK(memcmp(&got[0], &expect[0], n) == 0);
+                    CHECK(got[n] == 0x5a);
+                }
+
+                expect.assign(a.begin() + offset, a.end());
+                expect.resize(n + 1);
+                s.composite(&expect[0], &b[offset], n, t);
+                for (size_t v = 1; v < count; v++) {
+                    got.assign(a.begin() + offset, a.end());
+                    got.resize(n + 1);
+                    got[n] = 0x5a;
+                    variants[v]->composite(&got[0], &b[offset], n, t);
+                    CHECK(memcmp(&got[0], &expect[0], n) == 0);
+                    CHECK(got[n] == 0x5a);
+                }
+
+                s.dither(&expect[0], &wide[offset], n, t);
+                for (size_t v = 1; v < count; v++) {
+                    got[n] = 0x5a;
+                    variants[v]->dither(&got[0], &wide[offset], n, t);
+                    CHECK(memcmp(&got[0], &expect[0], n) == 0);
+                    CHECK(got[n] == 0x5a);
+                }
+            }
+
+            std::vector<uint8_t> expect(n + 1), got(n + 1);
+            scalarKernels.gamma(&expect[0], &a[offset], n, table);
+            for (size_t v = 1; v < count; v++) {
+                got[n] = 0x5a;
+                variants[v]->gamma(&got[0], &a[offset], n, table);
+                CHECK(memcmp(&got[0], &expect[0], n) == 0);
+                CHECK(got[n] == 0x5a);
+            }
+        }
+
+    printf("kernels:");
+    for (size_t v = 0; v < count; v++)
+        printf(" %s", variants[v]->name);
+    printf("\n");
+    return checkDone("kernels");
+}
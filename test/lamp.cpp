@@ -0,0 +1,112 @@
+// The lamp, built for the host, for comparing with the real thing. Each
+// argument goes to it as a line of serial input, once it has booted, and
+// whatever it sends back goes to stdout:
+//
+//   make -C test lamp
+//   test/build/lamp c 'r 2 60 20 1 7 0'
+//
+// prints the same CRCs as sending those commands to a lamp with the same
+// config; see checksum.h.
+//
+// With --replay first, the lamp takes the commands, then runs through the
+// timeline on stdin instead, and writes out the frame each line leaves
+// behind, back to back, in place of what it sends. Each line is
+//
+//   <ms> <mode> [reset]
+//
+// for a frame the lamp showed at ms on its clock, drawn by mode, with reset
+// where the lamp restarted just before it, or
+//
+//   <ms> <mode> quiet
+//
+// for a time the lamp ran the mode in between, when there's no frame to
+// write out. tools/flightdump.py --replay feeds it a flight recording this
+// way to see whether the lamp draws what was recorded.
+//
+// With --live <mode> [seconds] instead, it runs mode in real time, as the
+// lamp's loop does, for that long or until it's stopped. Built with VIEWER,
+// as make -C test viewer does, that's something for tools/viewer.py to
+// watch, and it says what publishing the frames cost when it's done.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+
+void setup();
+void checkSerial();
+void runMode(int mode);
+
+extern NeoPixelBus<NeoRgbwFeature, NeoWs2813Method> ring;
+extern uint32_t frameMillis;
+extern int lastMode;
+extern const size_t modeCount;
+
+static int replay()
+{
+    char line[64];
+    unsigned n = 0;
+    while (fgets(line, sizeof(line), stdin)) {
+        n++;
+        unsigned ms;
+        int mode;
+        char word[8] = "";
+        int fields = sscanf(line, "%u %d %7s", &ms, &mode, word);
+        if (fields < 2 || mode < 0 || mode >= int(modeCount)) {
+            fprintf(stderr, "replay: line %u: %s", n, line);
+            return 1;
+        }
+        // Booting again starts the mode over, as well as the lamp's clock.
+        if (!strcmp(word, "reset")) {
+            setup();
+            lastMode = -1;
+        }
+        frameMillis = ms;
+        runMode(mode);
+        if (strcmp(word, "quiet"))
+            fwrite(ring.Pixels(), 1, ring.PixelsSize(), stdout);
+    }
+    return 0;
+}
+
+static int live(int mode, unsigned seconds)
+{
+    if (mode < 0 || mode >= int(modeCount)) {
+        fprintf(stderr, "live: no mode %d\n", mode);
+        return 1;
+    }
+    const unsigned long end = millis() + seconds * 1000ul;
+    while (!seconds || millis() < end) {
+        frameMillis = millis();
+        runMode(mode);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#ifdef VIEWER
+    Serial.input += "v\n";
+    checkSerial();
+#endif
+    fwrite(Serial.output.data(), 1, Serial.output.size(), stdout);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    setup();
+    if (argc > 2 && !strcmp(argv[1], "--live"))
+        return live(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 0);
+
+    bool replaying = argc > 1 && !strcmp(argv[1], "--replay");
+    for (int i = replaying ? 2 : 1; i < argc; i++) {
+        Serial.input += argv[i];
+        Serial.input += '\n';
+    }
+    checkSerial();
+
+    if (replaying)
+        return replay();
+    fwrite(Serial.output.data(), 1, Serial.output.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Checks life's bit-sliced step against counting each cell's neighbours one
+// at a time: a blinker, a glider crossing the edges of the torus, and random
+// grids of widths that do and don't fill their last word. Then times a
+// 256x256 generation on this machine.
+
+#include <chrono>
+#include <vector>
+#include <Arduino.h>
+#include "life.h"
+#include "rng.h"
+#include "check.h"
+
+typedef std::vector<bool> grid;
+
+static grid cellsOf(const life& l)
+{
+    grid g(l.width() * l.height());
+    for (uint16_t y = 0; y < l.height(); y++)
+        for (uint16_t x = 0; x < l.width(); x++)
+            g[y * l.width() + x] = l.get(x, y);
+    return g;
+}
+
+// naiveStep works out the next generation of g, w cells wide, the slow way.
+static grid naiveStep(const grid& g, int w, int h)
+{
+    grid out(g.size());
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++) {
+            int n = 0;
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dx = -1; dx <= 1; dx++)
+                    if (dx || dy)
+                        n += g[(y + dy + h) % h * w + (x + dx + w) % w];
+            bool alive = g[y * w + x];
+            out[y * w + x] = n == 3 || (alive && n == 2);
+        }
+    return out;
+}
+
+static size_t count(const grid& g)
+{
+    size_t n = 0;
+    for (bool c : g)
+        n += c;
+    return n;
+}
+
+// matches runs l and the naive step side by side for generations.
+static bool matches(life& l, int generations)
+{
+    grid g = cellsOf(l);
+    for (int i = 0; i < generations; i++) {
+        g = naiveStep(g, l.width(), l.height());
+        uint32_t population = l.step();
+        if (cellsOf(l) != g || population != count(g))
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    // A blinker flips between across and down, every other generation.
+    life blinker(5, 5);
+    blinker.set(1, 2, true);
+    blinker.set(2, 2, true);
+    blinker.set(3, 2, true);
+    CHECK(blinker.step() == 3);
+    CHECK(blinker.get(2, 1) && blinker.get(2, 2) && blinker.get(2, 3) &&
+          !blinker.get(1, 2) && !blinker.get(3, 2));
+    CHECK(blinker.step() == 3);
+    CHECK(blinker.get(1, 2) && blinker.get(2, 2) && blinker.get(3, 2));
+
+    // A glider heading down and right from the top left corner of a grid
+    // 40 wide, so it crosses a word boundary and both edges, comes back to
+    // where it started after 4 * 40 generations.
+    life glider(40, 40);
+    const int shape[5][2] = {{1, 0}, {2, 1}, {0, 2}, {1, 2}, {2, 2}};
+    for (auto& c : shape)
+        glider.set(c[0], c[1], true);
+    grid start = cellsOf(glider);
+    CHECK(matches(glider, 4));
+    CHECK(glider.get(2, 1) && glider.get(3, 2) && glider.get(1, 3));
+    CHECK(matches(glider, 4 * 40 - 4));
+    CHECK(cellsOf(glider) == start);
+
+    // Placed straddling the corner, where every neighbour wraps.
+    life corner(33, 7);
+    for (auto& c : shape)
+        corner.set((c[0] + 31) % 33, (c[1] + 6) % 7, true);
+    CHECK(matches(corner, 50));
+
+    rngSeed(11);
+    const uint16_t sizes[][2] = {
+        {32, 32}, {31, 9}, {33, 3}, {64, 20}, {100, 37}, {256, 256}};
+    for (auto& s : sizes) {
+        life l(s[0], s[1]);
+        l.seed(80);
+        CHECK(matches(l, 30));
+    }
+
+    life big(256, 256);
+    big.seed(80);
+    const int generations = 500;
+    auto began = std::chrono::steady_clock::now();
+    for (int i = 0; i < generations; i++)
+        big.step();
+    double us = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - began).count();
+    printf("life 256x256: %.1f us/generation\n", us / generations);
+
+    return checkDone("life");
+}
@@ -0,0 +1,63 @@
+// Runs envelopes through trigger and release, including releasing one part
+// way through and triggering it again, and checks that a source reading
+// another sees a change to its input within the same frame time.
+
+#include <math.h>
+#include "modulation.h"
+#include "check.h"
+
+static bool near(float a, float b)
+{
+    return fabsf(a - b) < 0.001f;
+}
+
+int main()
+{
+    modGraph mods;
+    // 100ms attack, 100ms decay to half, 200ms release.
+    modSource env = mods.addEnvelope(100, 100, 0.5f, 200, 1.0f);
+    CHECK(env == 0);
+
+    CHECK(near(mods.value(env, 0), 0.0f));
+    mods.trigger(env, 1000);
+    CHECK(near(mods.value(env, 1050), 0.5f));
+    CHECK(near(mods.value(env, 1100), 1.0f));
+    CHECK(near(mods.value(env, 1150), 0.75f));
+    CHECK(near(mods.value(env, 1500), 0.5f));
+
+    // Released at sustain, it falls from there.
+    mods.release(env, 2000);
+    CHECK(near(mods.value(env, 2100), 0.25f));
+    CHECK(near(mods.value(env, 2200), 0.0f));
+
+    // Released during the attack, it falls from where it had got to...
+    mods.trigger(env, 3000);
+    mods.release(env, 3080);
+    CHECK(near(mods.value(env, 3080), 0.8f));
+    CHECK(near(mods.value(env, 3180), 0.4f));
+
+    // ...and the next trigger still decays to the sustain it was given.
+    mods.trigger(env, 4000);
+    CHECK(near(mods.value(env, 4100), 1.0f));
+    CHECK(near(mods.value(env, 4500), 0.5f));
+    mods.release(env, 5000);
+    CHECK(near(mods.value(env, 5100), 0.25f));
+
+    // A square LFO scaled by the envelope. Both have cached a value for
+    // 6000 when the envelope is retriggered, and then when its depth
+    // changes; the LFO has to follow straight away.
+    modSource lfo = mods.addLfo(lfoSquare, 1000, 1.0f, env);
+    mods.trigger(env, 6000);
+    CHECK(near(mods.value(lfo, 6050), 0.5f));
+    CHECK(near(mods.value(env, 6050), 0.5f));
+    mods.trigger(env, 6050);
+    CHECK(near(mods.value(lfo, 6050), 0.0f));
+    CHECK(near(mods.value(lfo, 6100), 0.5f));
+    mods.setDepth(env, 0.5f);
+    CHECK(near(mods.value(lfo, 6100), 0.25f));
+    mods.release(env, 6100);
+    CHECK(near(mods.value(lfo, 6100), 0.25f));
+    CHECK(near(mods.value(lfo, 6200), 0.125f));
+
+    return checkDone("modulation");
+}
@@ -0,0 +1,111 @@
+// Sends the lamp's MQTT client, built with MQTT_CONTROL against the host's
+// stand-in broker, good and bad messages. Numbers that are out of range or
+// not numbers at all are counted and dropped rather than read as 0, scenes
+// reach the config seqlock, and the telemetry reports the latency of
+// commands and scenes separately.
+
+#include <string.h>
+#include <unistd.h>
+#include <thread>
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include "mqtt.h"
+#include "check.h"
+
+static const lampConfig base = {
+    15000, 200, 20000, 128, 0.3f, 24, 255, 4000, 0, 0, 60000, 0};
+
+static void startTask(void (*task)(void*), void* arg)
+{
+    std::thread(task, arg).detach();
+}
+
+// next waits up to a second for the MQTT task to pass on a command.
+static bool next(lampCommand& cmd)
+{
+    for (int i = 0; i < 1000; i++) {
+        if (mqttCommands.pop(cmd))
+            return true;
+        hostMqttWait();
+    }
+    return false;
+}
+
+static bool is(const lampCommand& cmd, commandType type, uint16_t value)
+{
+    return cmd.type == type && cmd.value == value;
+}
+
+// field reads a number out of the latest telemetry, or returns -1.
+static long field(const std::string& telemetry, const char* name)
+{
+    std::string key = std::string("\"") + name + "\":";
+    size_t at = telemetry.find(key);
+    return at == std::string::npos ? -1 :
+           strtol(telemetry.c_str() + at + key.size(), nullptr, 10);
+}
+
+int main()
+{
+    seqlock<lampConfig> configs;
+    configs.publish(base);
+    configPixelLimit(24);
+    hostTaskCreated = startTask;
+    mqttBegin(&configs, 5);
+
+    const char* modes[] = {"3", "", "abc", "2x", "5", "-1", "65536", " 1"};
+    for (const char* m : modes)
+        hostMqttSend("lamp/mode", m);
+    const char* levels[] = {"255", "256", "0"};
+    for (const char* b : levels)
+        hostMqttSend("lamp/brightness", b);
+    hostMqttSend("lamp/other", "1");
+
+    // Only the good ones come through, in the order they were sent.
+    lampCommand cmd;
+    CHECK(next(cmd) && is(cmd, commandMode, 3));
+    CHECK(next(cmd) && is(cmd, commandBrightness, 255));
+    CHECK(next(cmd) && is(cmd, commandBrightness, 0));
+    uint32_t commandAt = cmd.received;
+
+    // A scene goes straight to the seqlock, and a command follows it to say
+    // when it arrived. A bad one changes nothing.
+    uint32_t version = 0;
+    lampConfig config;
+    configs.read(config, version);
+    hostMqttSend("lamp/scene", "{\"kelvin\": 2700}");
+    CHECK(next(cmd) && cmd.type == commandScene);
+    uint32_t sceneAt = cmd.received;
+    CHECK(configs.read(config, version) && config.kelvin == 2700 &&
+          config.fadeDelay == base.fadeDelay);
+    hostMqttSend("lamp/scene", "{\"kelvin\": warm}");
+    hostMqttSend("lamp/mode", "1");
+    CHECK(next(cmd) && is(cmd, commandMode, 1));
+    CHECK(!configs.read(config, version));
+
+    mqttShown(commandBrightness, commandAt);
+    mqttShown(commandScene, sceneAt);
+    uint32_t sceneUs = micros() - sceneAt;
+
+    // Telemetry goes out every five seconds.
+    std::string telemetry;
+    for (int i = 0; i < 6000 && field(telemetry, "rejected") != 9; i++) {
+        std::vector<std::pair<std::string, std::string> > sent =
+            hostMqttPublished();
+        if (!sent.empty() && sent.back().first == "lamp/telemetry")
+            telemetry = sent.back().second;
+        hostMqttWait();
+    }
+    CHECK(field(telemetry, "rejected") == 9);
+    CHECK(field(telemetry, "dropped") == 0);
+    CHECK(field(telemetry, "latencyMaxUs") >= 0);
+    CHECK(field(telemetry, "sceneLatencyUs") > 0);
+    CHECK(field(telemetry, "sceneLatencyUs") <= long(sceneUs));
+    CHECK(field(telemetry, "sceneLatencyMaxUs") ==
+          field(telemetry, "sceneLatencyUs"));
+
+    // The MQTT task never ends, so leave without tearing down what it uses.
+    int failed = checkDone("mqtt");
+    fflush(stdout);
+    _exit(failed);
+}
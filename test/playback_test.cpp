@@ -0,0 +1,146 @@
+// Plays shows from files through the host build's reader thread: frames
+// come out in order, a show that fell behind skips ahead to catch up, and
+// frames that aren't there in time are counted as underruns. Then runs the
+// lamp's playback mode, built with SD_PLAYBACK, and switches away from it,
+// which has to close the show and stop the reader.
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <Arduino.h>
+#include "playback.h"
+#include "check.h"
+
+void setup();
+void runMode(int mode);
+
+extern uint32_t frameMillis;
+extern const size_t modeCount;
+
+static const uint16_t frameBytes = 16;
+
+// writeShow writes a show of frames frames to path. Every byte of frame n
+// is n.
+static void writeShow(const std::string& path, uint32_t frames)
+{
+    FILE* f = fopen(path.c_str(), "wb");
+    showHeader header = {{'L', 'S', 'H', 'W'}, frameBytes, 20, frames};
+    fwrite(&header, sizeof(header), 1, f);
+    for (uint32_t n = 0; n < frames; n++)
+        for (uint16_t i = 0; i < frameBytes; i++)
+            fputc(n, f);
+    fclose(f);
+}
+
+static void sleepMs(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// waitFor asks for frame due until it comes, for up to a second.
+static bool waitFor(uint32_t due, uint8_t* out)
+{
+    for (int i = 0; i < 1000; i++) {
+        if (playbackFrame(due, out))
+            return true;
+        sleepMs(1);
+    }
+    return false;
+}
+
+static bool filledWith(const uint8_t* frame, size_t len, uint8_t value)
+{
+    for (size_t i = 0; i < len; i++)
+        if (frame[i] != value)
+            return false;
+    return true;
+}
+
+static unsigned underruns()
+{
+    Serial.output.clear();
+    playbackReport(Serial);
+    unsigned shown = 0, missed = 0;
+    sscanf(Serial.output.c_str(), "playback: %u frames shown, %u underruns",
+           &shown, &missed);
+    return missed;
+}
+
+int main(int, char** argv)
+{
+    const std::string path = std::string(argv[0]) + ".lsh";
+    uint8_t out[frameBytes + 4];
+
+    CHECK(!playbackOpen((path + ".missing").c_str(), frameBytes));
+    FILE* f = fopen(path.c_str(), "wb");
+    fputs("not a show at all", f);
+    fclose(f);
+    CHECK(!playbackOpen(path.c_str(), frameBytes));
+
+    writeShow(path, 100);
+    CHECK(playbackOpen(path.c_str(), frameBytes));
+    CHECK(playbackFrameMs() == 20);
+    CHECK(waitFor(0, out) && filledWith(out, frameBytes, 0));
+    unsigned missed = underruns();
+
+    // With the buffers full, a show that's fallen behind goes straight to
+    // the frame that's due, and only shows it once.
+    sleepMs(50);
+    CHECK(playbackFrame(5, out) && filledWith(out, frameBytes, 5));
+    CHECK(!playbackFrame(5, out));
+    CHECK(playbackFrame(6, out) && filledWith(out, frameBytes, 6));
+    CHECK(underruns() == missed);
+
+    // Further behind than the buffers go: that's an underrun, counted once
+    // however often the frame is asked for, and the show catches up, round
+    // the end and back to the start, as frames arrive.
+    CHECK(!playbackFrame(250, out));
+    CHECK(underruns() == missed + 1);
+    CHECK(!playbackFrame(250, out) || filledWith(out, frameBytes, 50));
+    CHECK(underruns() == missed + 1);
+    CHECK(waitFor(250, out) && filledWith(out, frameBytes, 50));
+    CHECK(underruns() == missed + 1);
+    playbackClose();
+
+    // Starting part way through, into buffers bigger than the show's frames,
+    // which are padded out with black.
+    CHECK(playbackOpen(path.c_str(), frameBytes + 4, 42));
+    CHECK(waitFor(42, out) && filledWith(out, frameBytes, 42) &&
+          filledWith(out + frameBytes, 4, 0));
+    playbackClose();
+
+    // A show with no frames never has one ready: every frame asked for is
+    // an underrun, once.
+    writeShow(path, 0);
+    CHECK(playbackOpen(path.c_str(), frameBytes));
+    missed = underruns();
+    sleepMs(20);
+    CHECK(!playbackFrame(0, out));
+    CHECK(!playbackFrame(0, out));
+    CHECK(underruns() == missed + 1);
+    sleepMs(20);
+    CHECK(!playbackFrame(1, out));
+    CHECK(!playbackFrame(2, out));
+    CHECK(underruns() == missed + 3);
+    playbackClose();
+
+    remove(path.c_str());
+
+    // Playback is the last mode. Every other mode it's left for stops it.
+    const int playback = modeCount - 1;
+    writeShow(SHOW_PATH, 100);
+    setup();
+    frameMillis = 1000;
+    for (int other = 0; other < playback; other++) {
+        runMode(playback);
+        frameMillis += 20;
+        runMode(playback);
+        CHECK(playbackActive());
+        frameMillis += 20;
+        runMode(other);
+        CHECK(!playbackActive());
+        frameMillis += 20;
+    }
+    remove(SHOW_PATH);
+    return checkDone("playback");
+}
@@ -0,0 +1,90 @@
+// Runs the lamp, built with RAIL_SWITCH, dark for a while and lit again. The
+// rail has to go off once the output has been black for RailOffDelay, and
+// come back on before the next lit frame, which is held until the pixels
+// have had time to power up rather than holding up the loop.
+
+#include <chrono>
+#include <thread>
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "check.h"
+
+void setup();
+void runMode(int mode);
+void show();
+void setBrightness(uint8_t level);
+
+extern uint32_t frameMillis;
+
+// As in main.cpp.
+static const uint8_t RailPin = 27;
+static const uint32_t RailOffDelay = 2000;
+static const uint32_t RailPowerUpMs = 5;
+
+// Frames that went out, lit or not, and lit ones that went out with the
+// rail off.
+static unsigned litShows;
+static unsigned darkShows;
+static unsigned unpowered;
+
+static void shown(const uint8_t* pixels, size_t size)
+{
+    bool lit = false;
+    for (size_t i = 0; i < size; i++)
+        lit |= pixels[i] != 0;
+    if (lit) {
+        litShows++;
+        unpowered += hostPins[RailPin] != HIGH;
+    } else {
+        darkShows++;
+    }
+}
+
+// run runs the light for ms of frame time, 20ms a frame.
+static void run(uint32_t ms)
+{
+    for (uint32_t end = frameMillis + ms; frameMillis < end;) {
+        frameMillis += 20;
+        runMode(3);
+    }
+}
+
+int main()
+{
+    setup();
+    hostShow = shown;
+    CHECK(hostPins[RailPin] == HIGH);
+
+    frameMillis = 1000;
+    run(200);
+    CHECK(litShows > 0);
+    CHECK(hostPins[RailPin] == HIGH);
+
+    // Dimmed all the way down, the way a remote command does it. The rail
+    // stays up until the output has been black for long enough.
+    setBrightness(0);
+    show();
+    run(RailOffDelay - 100);
+    CHECK(hostPins[RailPin] == HIGH);
+    run(200);
+    CHECK(hostPins[RailPin] == LOW);
+    unsigned lit = litShows, dark = darkShows;
+    run(1000);
+    CHECK(hostPins[RailPin] == LOW);
+    CHECK(darkShows == dark);
+
+    // Up again: the rail comes on at once, but the frame waits until the
+    // pixels can take it, and then goes out without being asked for again.
+    setBrightness(255);
+    show();
+    CHECK(hostPins[RailPin] == HIGH);
+    CHECK(litShows == lit);
+    std::this_thread::sleep_for(std::chrono::milliseconds(RailPowerUpMs + 1));
+    frameMillis++;
+    runMode(3);
+    CHECK(litShows == lit + 1);
+    CHECK(hostPins[RailPin] == HIGH);
+
+    CHECK(unpowered == 0);
+    return checkDone("rail");
+}
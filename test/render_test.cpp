@@ -0,0 +1,61 @@
+// Renders the modes offline, the way the 'r' command and tools/golden.py
+// do, and checks that the same mode and seed always give the same frames,
+// whatever ran before.
+
+#include <string>
+#include <Arduino.h>
+#include "check.h"
+
+void setup();
+void renderOffline(int mode, uint32_t duration, uint16_t step, uint16_t every,
+                   uint32_t seed, uint32_t from);
+
+const int Modes = 5;
+
+// render returns the frames and CRC that rendering mode sends, without the
+// time it took. Anything else sent in among the frames, which would garble
+// them for tools/render.py, makes it no render at all.
+static std::string render(int mode, uint32_t seed)
+{
+    Serial.output.clear();
+    renderOffline(mode, 60000, 20, 5, seed, 0);
+    const std::string& out = Serial.output;
+    unsigned frames = 0, frameBytes = 0;
+    size_t begin = out.find('\n');
+    size_t end = out.rfind("render end");
+    size_t crc = out.rfind("crc=");
+    if (begin == std::string::npos || end == std::string::npos ||
+        crc == std::string::npos || end <= begin ||
+        sscanf(out.c_str(), "render begin mode=%*d frames=%u framebytes=%u",
+               &frames, &frameBytes) != 2 ||
+        end - begin - 1 != size_t(frames) * frameBytes)
+        return "no render";
+    return out.substr(begin + 1, end - begin - 1) + out.substr(crc);
+}
+
+int main()
+{
+    // The output stage starts out dark, until the lamp has booted.
+    setup();
+
+    for (int mode = 0; mode < Modes; mode++) {
+        std::string first = render(mode, 7);
+        CHECK(first != "no render");
+        // Everything but off draws something.
+        if (mode > 0)
+            CHECK(first.find_first_not_of('\0') < first.find("crc="));
+        // The same mode again straight away, and after each of the others
+        // with a different seed.
+        CHECK(render(mode, 7) == first);
+        for (int other = 0; other < Modes; other++) {
+            if (other == mode)
+                continue;
+            render(other, 99);
+            if (render(mode, 7) != first) {
+                printf("mode %d after mode %d: ", mode, other);
+                CHECK(false);
+            }
+        }
+    }
+    return checkDone("render");
+}
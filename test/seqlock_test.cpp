@@ -0,0 +1,132 @@
+// Hammers a seqlock from several writers and readers at once. Every block a
+// writer publishes is filled in from its writer and count, so a reader can
+// tell if what it got was torn between two updates.
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "seqlock.h"
+#include "check.h"
+
+// Blocks are far bigger than a cache line and built ahead of time, so
+// readers and writers spend most of their time copying them, which is when
+// a torn read can happen, even on one core.
+const uint32_t blockWords = 256;
+const uint32_t variants = 64;
+
+struct block
+{
+    uint32_t writer;
+    uint32_t count;
+    uint32_t words[blockWords];
+    uint8_t tail[3];
+};
+
+static block blocks[4][variants];
+
+// Each writer's updates cycle through its variants, which all differ in
+// every word.
+static void build(int writers)
+{
+    for (int w = 0; w <= writers; w++)
+        for (uint32_t v = 0; v < variants; v++) {
+            block& b = blocks[w][v];
+            uint32_t x = w * 0x9e3779b9u + v * 0x85ebca6bu + 1;
+            for (uint32_t i = 0; i < blockWords; i++) {
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                b.words[i] = x;
+            }
+            b.writer = w;
+            b.count = 0;
+            b.tail[0] = b.tail[1] = b.tail[2] = x;
+        }
+}
+
+static const block& make(uint32_t writer, uint32_t count)
+{
+    block& b = blocks[writer][count % variants];
+    b.count = count;
+    return b;
+}
+
+static bool whole(const block& b, int writers)
+{
+    if (b.writer > uint32_t(writers))
+        return false;
+    const block& expect = blocks[b.writer][b.count % variants];
+    return memcmp(b.words, expect.words, sizeof(b.words)) == 0 &&
+           memcmp(b.tail, expect.tail, sizeof(b.tail)) == 0;
+}
+
+int main()
+{
+    const int writers = 3;
+    const int readers = 3;
+
+    build(writers);
+    seqlock<block> lock;
+    lock.publish(make(0, 0));
+
+    std::atomic<bool> running(true);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> backwards(0);
+    std::atomic<uint32_t> reads(0);
+    uint32_t published[writers + 1] = {};
+
+    std::vector<std::thread> threads;
+    for (int w = 1; w <= writers; w++)
+        threads.emplace_back([&, w] {
+            uint32_t c = 0;
+            while (running.load(std::memory_order_relaxed))
+                lock.publish(make(w, ++c));
+            published[w] = c;
+        });
+    for (int r = 0; r < readers; r++)
+        threads.emplace_back([&] {
+            uint32_t version = 0;
+            // The last count seen from each writer. A writer's updates go
+            // out in order, so a reader can't see one go backwards.
+            uint32_t seen[writers + 1] = {};
+            block b;
+            while (running.load(std::memory_order_relaxed)) {
+                uint32_t before = version;
+                if (!lock.read(b, version)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                reads++;
+                if (!whole(b, writers))
+                    torn++;
+                else if (b.count < seen[b.writer] || version <= before)
+                    backwards++;
+                else
+                    seen[b.writer] = b.count;
+            }
+        });
+
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    printf("seqlock: %u reads, %u + %u + %u writes\n", unsigned(reads.load()),
+        unsigned(published[1]), unsigned(published[2]),
+        unsigned(published[3]));
+    CHECK(torn.load() == 0);
+    CHECK(backwards.load() == 0);
+    CHECK(reads.load() > 0);
+
+    // With the writers done, the block is one writer's last update, and
+    // after reading it there's nothing new.
+    uint32_t version = 0;
+    block b;
+    CHECK(lock.read(b, version));
+    CHECK(whole(b, writers) && b.writer >= 1 &&
+          b.count == published[b.writer]);
+    CHECK(!lock.read(b, version));
+
+    return checkDone("seqlock");
+}
@@ -0,0 +1,149 @@
+// Takes every mode of the host lamp through a snapshot and back. Each one
+// runs for a few seconds of frame time and is snapshotted, then carries on
+// for a while, keeping a CRC of every frame. It's then set up from scratch
+// further along the clock, run for a while, has the ring scribbled over,
+// and is restored. The ring has to come back as it was when the snapshot
+// was taken, and the mode has to go on to draw the same frames it did the
+// first time. The random numbers, modulation and hues aren't the mode's to
+// snapshot, so they're put back as they were. Snapshots from another
+// version, or that have been damaged, have to be turned down.
+//
+// The Makefile builds this once as the lamp is configured and once with
+// PANEL, whose life mode has the most state.
+
+#include <vector>
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "checksum.h"
+#include "hues.h"
+#include "modulation.h"
+#include "rng.h"
+#include "snapshot.h"
+#include "check.h"
+
+// Sized in main.cpp; here it's only ever handled by reference, in buffers
+// of snapshotBytes.
+struct modeSnapshot;
+
+void setup();
+void runMode(int mode);
+void stopMode();
+void buildModulation();
+void tuneModulation();
+void snapshotMode(int mode, modeSnapshot& out);
+int restoreMode(const modeSnapshot& in);
+
+extern NeoPixelBus<NeoRgbwFeature, NeoWs2813Method> ring;
+extern uint32_t frameMillis;
+extern bool rendering;
+extern modGraph mods;
+extern hueScheduler hues;
+extern const size_t modeCount;
+extern const uint16_t SnapshotMaxData;
+
+static const uint32_t runFor = 4000;
+static const uint16_t step = 20;
+static const int checkFrames = 250;
+
+// A snapshot with room for any mode's state.
+struct snapshotBuffer
+{
+    std::vector<uint32_t> words;
+
+    snapshotBuffer()
+        : words((sizeof(snapshotHeader) + SnapshotMaxData + 3) / 4) {}
+    snapshotHeader& header() {return *(snapshotHeader*)words.data();}
+    uint8_t* data() {return (uint8_t*)words.data() + sizeof(snapshotHeader);}
+    modeSnapshot& snapshot() {return *(modeSnapshot*)words.data();}
+};
+
+static uint32_t shownCrc()
+{
+    return frameCrc(0, ring.Pixels(), ring.PixelsSize());
+}
+
+static void run(int mode, uint32_t* crcs)
+{
+    for (int f = 0; f < checkFrames; f++, frameMillis += step) {
+        runMode(mode);
+        if (crcs)
+            crcs[f] = shownCrc();
+    }
+}
+
+int main()
+{
+    static uint32_t frames[checkFrames];
+    snapshotBuffer before, bad;
+
+    setup();
+    rendering = true;
+    for (int mode = 0; mode < int(modeCount); mode++) {
+        stopMode();
+        frameMillis = 0;
+        rngSeed(1);
+        buildModulation();
+        tuneModulation();
+        hues.begin();
+
+        for (; frameMillis < runFor; frameMillis += step)
+            runMode(mode);
+        snapshotMode(mode, before.snapshot());
+        CHECK(before.header().mode == mode);
+        CHECK(before.header().size <= SnapshotMaxData);
+        const uint32_t snapshotAt = frameMillis;
+        const uint32_t rng = rngState();
+        const modGraph savedMods = mods;
+        const hueScheduler savedHues = hues;
+        const uint32_t shown = shownCrc();
+
+        // How it carries on without the snapshot.
+        run(mode, frames);
+
+        // Somewhere else, some time later.
+        stopMode();
+        frameMillis += 12345;
+        run(mode, nullptr);
+        memset(ring.Pixels(), 0x5a, ring.PixelsSize());
+        ring.Dirty();
+
+        bad = before;
+        bad.header().version++;
+        bool refused = restoreMode(bad.snapshot()) < 0;
+        if (before.header().size) {
+            bad = before;
+            bad.data()[before.header().size / 2] ^= 1;
+            refused = refused && restoreMode(bad.snapshot()) < 0;
+        }
+
+        // And how it carries on from the snapshot. -1 is the frame the
+        // snapshot was taken on.
+        rngSeed(rng);
+        mods = savedMods;
+        hues = savedHues;
+        frameMillis = snapshotAt;
+        int differs = checkFrames;
+        if (restoreMode(before.snapshot()) != mode || shownCrc() != shown)
+            differs = -1;
+        for (int f = 0; differs == checkFrames && f < checkFrames;
+             f++, frameMillis += step) {
+            runMode(mode);
+            if (shownCrc() != frames[f])
+                differs = f;
+        }
+
+        if (!refused)
+            printf("snapshot mode %d: took a bad snapshot\n", mode);
+        else if (differs < checkFrames)
+            printf("snapshot mode %d: came back different, frame %d\n", mode,
+                   differs);
+        else
+            printf("snapshot mode %d: %u bytes, ok\n", mode,
+                   unsigned(snapshotBytes(before.header())));
+        CHECK(refused);
+        CHECK(differs == checkFrames);
+    }
+    stopMode();
+    rendering = false;
+    return checkDone("snapshot");
+}
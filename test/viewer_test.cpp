@@ -0,0 +1,97 @@
+// Runs the lamp, built with VIEWER, and reads what it publishes the way
+// tools/viewer.py does: every frame that went out lands in the ring intact,
+// and one a reader hasn't got to before it's overwritten is counted as
+// dropped. The ring is left behind for the Makefile to draw with viewer.py.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <NeoPixelBus.h>
+#include "viewer.h"
+#include "check.h"
+
+void setup();
+void runMode(int mode);
+void checkSerial();
+
+extern NeoPixelBus<NeoRgbwFeature, NeoWs2813Method> ring;
+extern uint32_t frameMillis;
+
+static std::vector<uint8_t> lastShown;
+static unsigned shows;
+
+static void shown(const uint8_t* pixels, size_t size)
+{
+    lastShown.assign(pixels, pixels + size);
+    shows++;
+}
+
+int main()
+{
+    setup();
+    hostShow = shown;
+
+    int fd = shm_open(VIEWER_NAME, O_RDWR, 0);
+    CHECK(fd >= 0);
+    if (fd < 0)
+        return checkDone("viewer");
+    const size_t frameBytes = ring.PixelsSize();
+    const size_t slotBytes =
+        (sizeof(viewerSlot) + frameBytes + 7) & ~size_t(7);
+    const size_t size = sizeof(viewerHeader) + slotBytes * ViewerSlots;
+    uint8_t* mem = static_cast<uint8_t*>(
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    viewerHeader* header = reinterpret_cast<viewerHeader*>(mem);
+    CHECK(header->magic == ViewerMagic && header->version == ViewerVersion);
+    CHECK(header->slots == ViewerSlots && header->frameBytes == frameBytes);
+
+    // Reading each frame as it comes, nothing is dropped, and the newest
+    // slot always holds what was shown.
+    const uint32_t before = header->written;
+    uint32_t last = before;
+    int wrong = 0;
+    for (uint32_t ms = 1000; ms < 3000; ms += 20) {
+        frameMillis = ms;
+        runMode(2);
+        uint32_t written = header->written;
+        if (written == last)
+            continue;
+        last = written;
+        const uint8_t* at = mem + sizeof(viewerHeader) +
+                            (written - 1) % ViewerSlots * slotBytes;
+        const viewerSlot* slot = reinterpret_cast<const viewerSlot*>(at);
+        wrong += slot->sequence != 2 * written || slot->ms != ms ||
+                 memcmp(slot + 1, lastShown.data(), frameBytes) != 0;
+        header->readUpTo = written;
+    }
+    CHECK(header->written - before == shows);
+    CHECK(shows > ViewerSlots * 2);
+    CHECK(wrong == 0);
+    CHECK(header->dropped == 0);
+
+    // A reader that stops reading loses every frame past a ring's worth.
+    const uint32_t read = header->written;
+    for (uint32_t ms = 3000; ms < 5000; ms += 20) {
+        frameMillis = ms;
+        runMode(2);
+    }
+    uint32_t written = header->written;
+    CHECK(written - read > ViewerSlots);
+    CHECK(header->dropped == written - read - ViewerSlots);
+
+    Serial.output.clear();
+    Serial.input = "v\n";
+    checkSerial();
+    unsigned frames = 0, dropped = 0;
+    CHECK(sscanf(Serial.output.c_str(), "viewer: %u frames, %u dropped",
+                 &frames, &dropped) == 2);
+    CHECK(frames == written && dropped == header->dropped);
+    printf("%s", Serial.output.c_str());
+
+    munmap(mem, size);
+    return checkDone("viewer");
+}
@@ -0,0 +1,191 @@
+#!/usr/bin/env python
+# Decodes a flight recorder dump (the 'd' serial command, or what the lamp
+# prints after a crash) back into frames.
+#
+# usage: python tools/flightdump.py [--raw frames.bin] < serial.log
+#        python tools/flightdump.py --replay test/build/lamp \
+#            [--config '{...}'] < serial.log
+#
+# Prints one line per frame with its time, mode and input events, 'reset'
+# among them where the lamp restarted. With --raw, also writes the frames
+# back to back as they went out on the wire (G, R, B, W for each pixel),
+# followed by a .txt with the time of each frame.
+#
+# --replay runs the recording through the lamp built for the host (make -C
+# test lamp): the same modes at the same times, restarting where the lamp
+# did. Each frame is then marked with whether the host drew it the same, or
+# by how much the worst channel differed, and the exit status is 1 if any
+# differed. A glitch that shows up in the recording but not in the replay
+# happened somewhere past the modes. Give the lamp's config, as printed by
+# the 'p' command, with --config. The recording only has the frames the lamp
+# showed, but modes can move on without showing anything, so in between the
+# replay runs the mode every --tick ms, about as often as the lamp's loop
+# goes round. The replay starts the first recorded mode
+# from scratch, so until the first switch or reset it only lines up if the
+# recording goes back to when that mode started. Where the lamp showed more
+# than one frame at the same time, setting a mode up and then running it,
+# only the last is compared.
+
+import argparse
+import subprocess
+import sys
+
+FLAG_KEY = 0x01
+FLAG_MODE = 0x02
+FLAG_EVENTS = 0x04
+
+EVENT_RESET = 0x04
+EVENTS = {0x01: 'switch', 0x02: 'serial', EVENT_RESET: 'reset'}
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7f) << shift
+        shift += 7
+        if b < 0x80:
+            return value, pos
+
+
+def read_dump(lines):
+    frame_bytes = None
+    records = []
+    inside = False
+    for line in lines:
+        line = line.strip()
+        if line.startswith('flight begin'):
+            fields = dict(f.split('=') for f in line.split()[2:])
+            frame_bytes = int(fields['framebytes'])
+            records = []
+            inside = True
+        elif line.startswith('flight cost'):
+            sys.stderr.write(line + '\n')
+        elif line == 'flight end':
+            inside = False
+        elif inside and line:
+            records.append(bytearray.fromhex(line))
+    return frame_bytes, records
+
+
+# decode yields each frame's time on the timeline, the time on the lamp's
+# clock, its mode, its events and the frame itself.
+def decode(frame_bytes, records):
+    frame = bytearray(frame_bytes)
+    ms = 0
+    clock = 0
+    mode = None
+    for rec in records:
+        flags = rec[0]
+        # The first frame after a reset has its time counted from the
+        # reboot. How long the lamp was down isn't known, so the timeline
+        # carries on from the last frame before it.
+        delta, pos = varint(rec, 1)
+        ms += delta
+        events = 0
+        if flags & FLAG_MODE:
+            mode = rec[pos]
+            pos += 1
+        if flags & FLAG_EVENTS:
+            events = rec[pos]
+            pos += 1
+        clock = delta if events & EVENT_RESET else clock + delta
+
+        if flags & FLAG_KEY:
+            frame[:] = rec[pos:pos + frame_bytes]
+        else:
+            at = 0
+            while pos < len(rec):
+                skip, pos = varint(rec, pos)
+                run, pos = varint(rec, pos)
+                at += skip
+                for i in range(run):
+                    frame[at + i] ^= rec[pos + i]
+                at += run
+                pos += run
+        yield ms, clock, mode, events, bytes(frame)
+
+
+# replay runs the decoded frames through the host lamp, and returns what it
+# drew for each of them, or None for those it wasn't asked about.
+def replay(lamp, config, tick, frames):
+    timeline = []
+    asked = []
+    reset = False
+    last = None
+    for i, (_, clock, mode, events, _) in enumerate(frames):
+        # A restart goes before whichever frame is replayed next.
+        reset = reset or events & EVENT_RESET
+        if last is not None and not reset:
+            timeline += ['%d %d quiet\n' % (ms, last[1])
+                         for ms in range(last[0] + tick, clock, tick)]
+        if (i + 1 == len(frames) or frames[i + 1][1] != clock or
+                frames[i + 1][3] & EVENT_RESET):
+            timeline.append('%d %d%s\n' % (clock, mode,
+                                           ' reset' if reset else ''))
+            asked.append(i)
+            reset = False
+            last = clock, mode
+    command = [lamp, '--replay'] + ([config] if config else [])
+    out = subprocess.run(command, input=''.join(timeline).encode('ascii'),
+                         stdout=subprocess.PIPE, check=True).stdout
+    frame_bytes = len(frames[0][4])
+    if len(out) != len(asked) * frame_bytes:
+        sys.exit('the lamp replayed %d bytes, expected %d' %
+                 (len(out), len(asked) * frame_bytes))
+    drawn = [None] * len(frames)
+    for n, i in enumerate(asked):
+        drawn[i] = out[n * frame_bytes:(n + 1) * frame_bytes]
+    return drawn
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin)
+    parser.add_argument('--raw', help='write the decoded frames here')
+    parser.add_argument('--replay', metavar='LAMP',
+                        help='replay the frames through the host lamp')
+    parser.add_argument('--config', help='the lamp\'s config, for --replay')
+    parser.add_argument('--tick', type=int, default=1,
+                        help='ms between runs of the mode, for --replay')
+    args = parser.parse_args()
+
+    frame_bytes, records = read_dump(args.log)
+    if frame_bytes is None:
+        sys.exit('no flight recorder dump found')
+    frames = list(decode(frame_bytes, records))
+    drawn = [None] * len(frames)
+    if args.replay and frames:
+        drawn = replay(args.replay, args.config, args.tick, frames)
+
+    raw = open(args.raw, 'wb') if args.raw else None
+    times = open(args.raw + '.txt', 'w') if args.raw else None
+    compared = 0
+    differed = []
+    for (ms, _, mode, events, frame), replayed in zip(frames, drawn):
+        names = [n for bit, n in sorted(EVENTS.items()) if events & bit]
+        line = '%10d ms  mode %s  %s' % (ms, mode, ' '.join(names))
+        if replayed is not None:
+            worst = max(abs(a - b) for a, b in zip(frame, replayed))
+            line += '  %s' % ('replayed the same' if not worst else
+                              'replay differs by %d' % worst)
+            compared += 1
+            if worst:
+                differed.append(ms)
+        print(line.rstrip())
+        if raw:
+            raw.write(frame)
+            times.write('%d\n' % ms)
+
+    if args.replay:
+        sys.stderr.write('replay: %d of %d frames the same%s\n' % (
+            compared - len(differed), compared,
+            ', first difference at %d ms' % differed[0] if differed else ''))
+        sys.exit(1 if differed else 0)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,195 @@
+#!/usr/bin/env python
+# Records reference renders of every mode and checks later builds against
+# them, so an optimization that changes what the lamp draws gets caught.
+#
+# usage: python tools/golden.py record /dev/ttyUSB0 golden/
+#        python tools/golden.py record --lamp test/build/lamp golden/
+#        python tools/golden.py check /dev/ttyUSB0 golden/ [--tolerance 2]
+#        python tools/golden.py check --lamp test/build/lamp golden/
+#        python tools/golden.py check --frames other/ golden/
+#
+# record renders each mode offline (see render.py) with a fixed clock and
+# seed, and saves the frames along with the config they were drawn with.
+# The frames come from a lamp on a serial port, or with --lamp from the lamp
+# built for the host (make -C test lamp), which is how make -C test checks
+# that renders repeat. check renders the same again, either way, or takes
+# frames recorded elsewhere with --frames, and compares. With no tolerance every byte has to match; with
+# one, each channel can be off by that much. Either way, any mode that
+# differs gets its worst and mean error per channel and the first frame it
+# went wrong in. The exit status is 1 if any mode is out of tolerance.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+from render import read_render, render_host
+
+CHANNELS = 'GRBW'
+
+
+# A lamp on a serial port, or the host lamp, to render frames with.
+class serial_lamp:
+    def __init__(self, path):
+        import serial
+        self.port = serial.Serial(path, 115200, timeout=30)
+
+    def config(self):
+        self.port.reset_input_buffer()
+        self.port.write(b'p')
+        return json.loads(self.port.readline().decode('ascii'))
+
+    def render(self, mode, seconds, step, seed):
+        self.port.write(b'r %d %d %d 1 %d 0\n' % (mode, seconds, step, seed))
+        return read_render(self.port)[1]
+
+
+class host_lamp:
+    def __init__(self, path):
+        self.path = path
+
+    def config(self):
+        out = subprocess.check_output([self.path, 'p'])
+        for line in out.decode('ascii').splitlines():
+            if line.startswith('{'):
+                return json.loads(line)
+        sys.exit('%s printed no config' % self.path)
+
+    def render(self, mode, seconds, step, seed):
+        # In one piece: a render split into pieces starts the mode again
+        # where they join.
+        return render_host(self.path, mode, seconds, step, 1, seed, 1)[1]
+
+
+def open_lamp(args):
+    return host_lamp(args.lamp) if args.lamp else serial_lamp(args.port)
+
+
+def render(lamp, mode, seconds, step, seed):
+    frames = lamp.render(mode, seconds, step, seed)
+    if not frames or len(frames[-1]) != len(frames[0]):
+        sys.exit('render of mode %d was cut short' % mode)
+    return b''.join(frames), len(frames[0])
+
+
+def frames_path(folder, mode):
+    return os.path.join(folder, 'mode%d.raw' % mode)
+
+
+def record(args):
+    lamp = open_lamp(args)
+    os.makedirs(args.golden, exist_ok=True)
+    manifest = {
+        'config': lamp.config(),
+        'seconds': args.seconds,
+        'step': args.step,
+        'seed': args.seed,
+        'modes': {},
+    }
+    for mode in args.modes:
+        data, manifest['framebytes'] = render(lamp, mode, args.seconds,
+                                              args.step, args.seed)
+        with open(frames_path(args.golden, mode), 'wb') as f:
+            f.write(data)
+        manifest['modes'][str(mode)] = len(data)
+        print('mode %d: %d bytes' % (mode, len(data)))
+    with open(os.path.join(args.golden, 'manifest.json'), 'w') as f:
+        json.dump(manifest, f, indent=2)
+
+
+def compare(mode, want, got, frame_bytes, tolerance):
+    if want == got:
+        print('mode %s: identical' % mode)
+        return True
+    if len(want) != len(got):
+        print('mode %s: %d bytes, expected %d' % (mode, len(got), len(want)))
+        return False
+
+    worst = [0] * 4
+    total = [0] * 4
+    first = None
+    for i, (a, b) in enumerate(zip(want, got)):
+        err = abs(a - b)
+        if not err:
+            continue
+        c = i % 4
+        total[c] += err
+        worst[c] = max(worst[c], err)
+        if first is None and err > tolerance:
+            first = i // frame_bytes
+
+    count = len(want) // 4
+    ok = first is None
+    print('mode %s: %s' % (mode, 'within tolerance' if ok else
+                           'differs from frame %d' % first))
+    for c in range(4):
+        print('  %s  max %3d  mean %.4f' % (CHANNELS[c], worst[c],
+                                           total[c] / float(count)))
+    return ok
+
+
+def check(args):
+    with open(os.path.join(args.golden, 'manifest.json')) as f:
+        manifest = json.load(f)
+
+    lamp = None
+    if not args.frames:
+        lamp = open_lamp(args)
+        if lamp.config() != manifest['config']:
+            print('warning: the lamp\'s config differs from the recording')
+
+    ok = True
+    for mode in sorted(manifest['modes'], key=int):
+        with open(frames_path(args.golden, int(mode)), 'rb') as f:
+            want = f.read()
+        if lamp:
+            got, _ = render(lamp, int(mode), manifest['seconds'],
+                            manifest['step'], manifest['seed'])
+        else:
+            with open(frames_path(args.frames, int(mode)), 'rb') as f:
+                got = f.read()
+        ok &= compare(mode, want, got, manifest['framebytes'],
+                      args.tolerance)
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    sub = parser.add_subparsers(dest='command')
+    rec = sub.add_parser('record')
+    rec.add_argument('port', nargs='?')
+    rec.add_argument('golden')
+    rec.add_argument('--lamp', help='render on this host build of the lamp '
+                     'instead')
+    # Every mode a lamp without a panel or SD card has. modeLight's report
+    # used to land in among its frames; it no longer does, so it's in too.
+    rec.add_argument('--modes', type=int, nargs='+',
+                     default=[0, 1, 2, 3, 4])
+    rec.add_argument('--seconds', type=int, default=120)
+    rec.add_argument('--step', type=int, default=20)
+    rec.add_argument('--seed', type=int, default=1)
+    chk = sub.add_parser('check')
+    chk.add_argument('port', nargs='?')
+    chk.add_argument('golden')
+    chk.add_argument('--lamp', help='render on this host build of the lamp '
+                     'instead')
+    chk.add_argument('--frames', help='compare frames recorded here instead '
+                     'of rendering on the lamp')
+    chk.add_argument('--tolerance', type=int, default=0)
+    args = parser.parse_args()
+
+    if args.command == 'record':
+        if not args.port and not args.lamp:
+            parser.error('record needs a port or --lamp')
+        record(args)
+    elif args.command == 'check':
+        if not args.port and not args.lamp and not args.frames:
+            parser.error('check needs a port, --lamp or --frames')
+        sys.exit(0 if check(args) else 1)
+    else:
+        parser.print_help()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,154 @@
+#!/usr/bin/env python
+# Generates src/huetable.h, the hue sequences the modes pick colors from.
+#
+# The color wheel is cut into BUCKETS hues. Each sequence visits every one
+# of them exactly once, so over a pass no hue comes up more often than any
+# other, and every hue is at least MIN_SEPARATION buckets round the wheel
+# from the two before it, so neither a fade from one color to the next nor
+# the two colors a mode picks together can be close enough to look the
+# same. The sequences all start with the same two hues and are built as
+# loops, so one sequence can follow the end of any other, or of itself,
+# and still keep the separation.
+#
+# usage: python tools/huetable.py > src/huetable.h
+#        python tools/huetable.py --check src/huetable.h
+
+import random
+import re
+import sys
+
+BUCKETS = 36
+MIN_SEPARATION = 6
+SEQUENCES = 16
+# Looking back this many hues.
+WINDOW = 2
+SEED = 100
+
+
+def distance(a, b):
+    d = abs(a - b) % BUCKETS
+    return min(d, BUCKETS - d)
+
+
+def fits(seq, hue):
+    return all(distance(hue, h) >= MIN_SEPARATION for h in seq[-WINDOW:])
+
+
+def closes(seq):
+    # Going round again from the start has to keep the separation too.
+    loop = seq + seq[:WINDOW]
+    return all(fits(loop[:i], loop[i]) for i in range(len(seq), len(loop)))
+
+
+def sequence(rng, start):
+    seq = list(start)
+    left = set(range(BUCKETS)) - set(seq)
+    # A depth first search, tried in random order, finds a loop quickly;
+    # nearly every partial sequence can be finished.
+    def extend():
+        if not left:
+            return closes(seq)
+        options = [h for h in left if fits(seq, h)]
+        rng.shuffle(options)
+        for h in options:
+            seq.append(h)
+            left.remove(h)
+            if extend():
+                return True
+            seq.pop()
+            left.add(h)
+        return False
+    if not extend():
+        raise RuntimeError("no sequence from %s" % (start,))
+    return seq
+
+
+def problems(table):
+    found = []
+    start = table[0][:WINDOW]
+    for n, seq in enumerate(table):
+        if sorted(seq) != list(range(BUCKETS)):
+            found.append("sequence %d doesn't visit every hue once" % n)
+        if seq[:WINDOW] != start:
+            found.append("sequence %d starts differently" % n)
+        loop = seq + seq[:WINDOW]
+        for i in range(1, len(loop)):
+            for back in range(1, WINDOW + 1):
+                if i >= back and distance(loop[i], loop[i - back]) < \
+                        MIN_SEPARATION:
+                    found.append("sequence %d: hues %d and %d too close"
+                                 % (n, i - back, i))
+    if len(set(tuple(s) for s in table)) != len(table):
+        found.append("sequences repeat")
+    return found
+
+
+def report(table):
+    # How far apart successive hues are, over every sequence.
+    steps = [0] * (BUCKETS // 2 + 1)
+    for seq in table:
+        for a, b in zip(seq, seq[1:] + seq[:1]):
+            steps[distance(a, b)] += 1
+    total = float(sum(steps))
+    for d, n in enumerate(steps):
+        if n:
+            sys.stderr.write("%4d degrees %5.1f%%\n"
+                             % (d * 360 // BUCKETS, 100 * n / total))
+
+
+def generate():
+    rng = random.Random(SEED)
+    start = [0, BUCKETS // 2]
+    table = []
+    while len(table) < SEQUENCES:
+        seq = sequence(rng, start)
+        if seq not in table:
+            table.append(seq)
+    return table
+
+
+def check(path):
+    text = open(path).read()
+    body = text[text.index("hueSequences"):]
+    table = [[int(h) for h in row.split(",") if h.strip()]
+             for row in re.findall(r"\{([\d,\s]+)\}", body)]
+    found = problems(table)
+    if len(table) != SEQUENCES:
+        found.append("%d sequences, not %d" % (len(table), SEQUENCES))
+    for p in found:
+        print(p)
+    report(table)
+    print("%s: %s" % (path, "FAILED" if found else "ok"))
+    return not found
+
+
+def main():
+    if len(sys.argv) == 3 and sys.argv[1] == "--check":
+        sys.exit(0 if check(sys.argv[2]) else 1)
+
+    table = generate()
+    assert not problems(table)
+    print("// Generated by tools/huetable.py, don't edit by hand.")
+    print("//")
+    print("// %d sequences of the %d hues, %d degrees apart, each at least %d"
+          % (SEQUENCES, BUCKETS, 360 // BUCKETS,
+             MIN_SEPARATION * 360 // BUCKETS))
+    print("// degrees from the %d before it. See hues.h." % WINDOW)
+    print("#pragma once")
+    print("#include <stdint.h>")
+    print("")
+    print("const uint8_t HueBuckets = %d;" % BUCKETS)
+    print("const uint8_t HueMinSeparation = %d;" % MIN_SEPARATION)
+    print("const uint8_t HueSequenceCount = %d;" % SEQUENCES)
+    print("")
+    print("const uint8_t hueSequences[][%d] = {" % BUCKETS)
+    for seq in table:
+        rows = []
+        for i in range(0, BUCKETS, 12):
+            rows.append(", ".join("%2d" % h for h in seq[i:i + 12]))
+        print("    {" + (",\n     ").join(rows) + "},")
+    print("};")
+
+
+if __name__ == '__main__':
+    main()
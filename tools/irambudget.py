@@ -0,0 +1,81 @@
+#!/usr/bin/env python
+# Shows how much of the ESP32's IRAM a build uses, and how much of that is
+# the lamp's own render path (LAMP_HOT in src/hot.h).
+#
+# usage: python tools/irambudget.py [.pio/build/featheresp32/firmware.elf]
+#
+# Needs the toolchain's nm, which is found on the PATH or in PlatformIO's
+# packages. Code is matched to the lamp by the source file in its debug
+# info, so the build needs -g, which PlatformIO uses by default.
+
+import glob
+import os
+import subprocess
+import sys
+
+# Instruction RAM usable for code on the ESP32.
+IRAM_START = 0x40080000
+IRAM_END = 0x400a0000
+
+# The lamp's own sources. Libraries have src directories too, under
+# .pio/libdeps, so only this one counts.
+SRC = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'src')
+
+
+def in_src(where):
+    # nm gives file:line, with an absolute path for anything PlatformIO built.
+    path = where.rpartition(':')[0]
+    if not path:
+        return False
+    path = os.path.normcase(os.path.normpath(path))
+    src = os.path.normcase(os.path.normpath(SRC))
+    return os.path.dirname(path) == src
+
+
+def find_nm():
+    for path in os.environ.get('PATH', '').split(os.pathsep):
+        nm = os.path.join(path, 'xtensa-esp32-elf-nm')
+        if os.path.exists(nm):
+            return nm
+    found = glob.glob(os.path.expanduser(
+        '~/.platformio/packages/toolchain-xtensa*/bin/xtensa-esp32-elf-nm'))
+    if not found:
+        sys.exit('can\'t find xtensa-esp32-elf-nm')
+    return found[0]
+
+
+def main():
+    elf = (sys.argv[1] if len(sys.argv) > 1
+           else '.pio/build/featheresp32/firmware.elf')
+    out = subprocess.check_output([find_nm(), '-C', '-S', '-l', elf])
+
+    total = 0
+    top = 0
+    lamp = []
+    for line in out.decode('utf-8', 'replace').splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue
+        try:
+            addr, size = int(parts[0], 16), int(parts[1], 16)
+        except ValueError:
+            continue
+        if not IRAM_START <= addr < IRAM_END:
+            continue
+        total += size
+        top = max(top, addr + size)
+        name, _, where = parts[3].partition('\t')
+        if in_src(where):
+            lamp.append((size, name.split(' ', 1)[-1]))
+
+    capacity = IRAM_END - IRAM_START
+    print('IRAM: %d of %d bytes in use, %d free for the heap' %
+          (top - IRAM_START, capacity, IRAM_END - top))
+    print('symbols in IRAM: %d bytes' % total)
+    print('lamp render path: %d bytes' % sum(s for s, _ in lamp))
+    for size, name in sorted(lamp, reverse=True):
+        print('  %6d  %s' % (size, name))
+
+
+if __name__ == '__main__':
+    main()
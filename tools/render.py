@@ -0,0 +1,179 @@
+#!/usr/bin/env python
+# Asks the lamp to render a mode offline (the 'r' serial command) and saves
+# the result as a PNG strip, a GIF or raw frames.
+#
+# usage: python tools/render.py /dev/ttyUSB0 --mode 2 --seconds 600 \
+#            --step 20 --every 10 --seed 1 --png rotator.png
+#        python tools/render.py --lamp test/build/lamp --mode 2 \
+#            --seconds 86400 --every 50 --png day.png
+#
+# The lamp runs the mode as fast as it can rather than in real time, so
+# minutes of animation come back in seconds; what limits long previews is the
+# serial link, so raise --every to send fewer frames. In the PNG strip each
+# row is one frame and each column one pixel. GIF output needs Pillow.
+# --show writes a show file for SD card playback (see src/playback.h). The
+# same mode, seed and config always render the same frames.
+#
+# With --lamp, the lamp built for the host (make -C test lamp) renders
+# instead, with no link in the way, and the render is split into --jobs
+# pieces run side by side. Each piece starts the mode afresh part way along
+# the clock, so the frames where two pieces join don't follow on the way
+# they would in one piece; --jobs 1 renders it in one go.
+
+import argparse
+import os
+import struct
+import subprocess
+import sys
+import zlib
+
+
+def to_rgb(frame):
+    # Frames arrive in wire order, G, R, B, W. Show the white channel as
+    # white.
+    out = bytearray()
+    for i in range(0, len(frame), 4):
+        g, r, b, w = frame[i:i + 4]
+        out += bytes((min(r + w, 255), min(g + w, 255), min(b + w, 255)))
+    return bytes(out)
+
+
+def write_png(path, rows, scale):
+    width = len(rows[0]) // 3 * scale
+    raw = bytearray()
+    for row in rows:
+        line = b''.join(row[i:i + 3] * scale for i in range(0, len(row), 3))
+        for _ in range(scale):
+            raw += b'\0' + line
+
+    def chunk(kind, data):
+        body = kind + data
+        return (struct.pack('>I', len(data)) + body +
+                struct.pack('>I', zlib.crc32(body) & 0xffffffff))
+
+    with open(path, 'wb') as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width,
+                                           len(rows) * scale, 8, 2, 0, 0, 0)))
+        f.write(chunk(b'IDAT', zlib.compress(bytes(raw), 9)))
+        f.write(chunk(b'IEND', b''))
+
+
+def write_gif(path, rows, step, scale):
+    from PIL import Image
+    pixels = len(rows[0]) // 3
+    images = [Image.frombytes('RGB', (pixels, 1), row)
+              .resize((pixels * scale, scale), Image.NEAREST) for row in rows]
+    images[0].save(path, save_all=True, append_images=images[1:],
+                   duration=step, loop=0)
+
+
+def read_render(port):
+    while True:
+        line = port.readline()
+        if not line:
+            sys.exit('no response from the lamp')
+        line = line.decode('ascii', 'replace').strip()
+        if line.startswith('render: '):
+            sys.exit(line)
+        if line.startswith('render begin'):
+            break
+    fields = dict(f.split('=') for f in line.split()[2:])
+    frame_bytes = int(fields['framebytes'])
+    frames = [port.read(frame_bytes) for _ in range(int(fields['frames']))]
+    end = port.readline().decode('ascii', 'replace')
+    sys.stderr.write(end)
+    # The lamp sends the CRC of what it sent, to catch a garbled link.
+    for field in end.split():
+        if (field.startswith('crc=') and
+                int(field[4:], 16) != zlib.crc32(b''.join(frames))):
+            sys.exit('frames were garbled on the way')
+    return int(fields['step']), frames
+
+
+def gcd(a, b):
+    while b:
+        a, b = b, a % b
+    return a
+
+
+# pieces splits seconds into up to jobs runs of (from, seconds), each
+# starting a whole number of frames in, so together they have as many
+# frames as one render would.
+def pieces(seconds, frame_ms, jobs):
+    unit = frame_ms // gcd(frame_ms, 1000)
+    units = (seconds + unit - 1) // unit
+    jobs = max(1, min(jobs, units))
+    starts = [units * n // jobs * unit for n in range(jobs)] + [seconds]
+    return [(starts[n], starts[n + 1] - starts[n]) for n in range(jobs)]
+
+
+# render_host renders on the host lamp, in pieces side by side, and returns
+# the frame time and the frames.
+def render_host(lamp, mode, seconds, step, every, seed, jobs):
+    runs = [subprocess.Popen([lamp, 'r %d %d %d %d %d %d' % (
+                mode, length, step, every, seed, start)],
+                stdout=subprocess.PIPE)
+            for start, length in pieces(seconds, step * every, jobs)]
+    frames = []
+    for run in runs:
+        step, part = read_render(run.stdout)
+        frames += part
+        run.wait()
+    return step, frames
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('port', nargs='?')
+    parser.add_argument('--lamp', help='render on this host build of the '
+                        'lamp instead')
+    parser.add_argument('--jobs', type=int, default=os.cpu_count() or 1,
+                        help='pieces to split a --lamp render into')
+    parser.add_argument('--mode', type=int, required=True)
+    parser.add_argument('--seconds', type=int, default=60)
+    parser.add_argument('--step', type=int, default=20,
+                        help='ms of frame time per frame')
+    parser.add_argument('--every', type=int, default=1,
+                        help='send one frame in this many')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--scale', type=int, default=4)
+    parser.add_argument('--png')
+    parser.add_argument('--gif')
+    parser.add_argument('--raw')
+    parser.add_argument('--show')
+    args = parser.parse_args()
+
+    if args.lamp:
+        step, frames = render_host(args.lamp, args.mode, args.seconds,
+                                   args.step, args.every, args.seed,
+                                   args.jobs)
+    elif args.port:
+        import serial
+        port = serial.Serial(args.port, 115200, timeout=30)
+        port.write(b'r %d %d %d %d %d 0\n' % (args.mode, args.seconds,
+                                               args.step, args.every,
+                                               args.seed))
+        step, frames = read_render(port)
+    else:
+        parser.error('render needs a port or --lamp')
+    if not frames or len(frames[-1]) != len(frames[0]):
+        sys.exit('render was cut short')
+
+    if args.raw:
+        with open(args.raw, 'wb') as f:
+            f.write(b''.join(frames))
+    if args.show:
+        with open(args.show, 'wb') as f:
+            f.write(struct.pack('<4sHHI', b'LSHW', len(frames[0]), step,
+                                len(frames)))
+            f.write(b''.join(frames))
+    rows = [to_rgb(f) for f in frames]
+    if args.png:
+        write_png(args.png, rows, args.scale)
+    if args.gif:
+        write_gif(args.gif, rows, step, args.scale)
+
+
+if __name__ == '__main__':
+    main()
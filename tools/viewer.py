@@ -0,0 +1,101 @@
+#!/usr/bin/env python
+# Shows the frames a host build with VIEWER publishes, live, in a terminal
+# with 24 bit color.
+#
+# usage: python tools/viewer.py [--name lamp] [--fps 30] [--once]
+#
+# make -C test viewer builds a host lamp that publishes; see src/viewer.h.
+# With --once, the newest frame is drawn and that's all, which is how the
+# tests check this still reads what the lamp writes.
+# The ring is drawn as a line of blocks, and the panel, if there is one,
+# underneath it, two rows of pixels to each line of text. Only the newest
+# frame is drawn each time round; the lamp counts any it had to overwrite
+# before they were seen. See src/viewer.h for the layout.
+
+import argparse
+import mmap
+import struct
+import sys
+import time
+
+MAGIC = 0x5257564c
+VERSION = 1
+HEADER = struct.Struct('<IHHIHHIIII')
+SLOT = struct.Struct('<IIHHI')
+WRITTEN = 16
+READ_UP_TO = 20
+
+
+def to_rgb(pixel):
+    # Wire order is G, R, B, W. Show the white channel as white.
+    g, r, b, w = pixel
+    return min(r + w, 255), min(g + w, 255), min(b + w, 255)
+
+
+def block(top, bottom=None):
+    if bottom is None:
+        return '\x1b[38;2;%d;%d;%dm█' % top
+    return '\x1b[38;2;%d;%d;%d;48;2;%d;%d;%dm▀' % (top + bottom)
+
+
+def draw(frame, ring_pixels, width, height):
+    pixels = [to_rgb(frame[i:i + 4]) for i in range(0, len(frame), 4)]
+    lines = [''.join(block(p) * 2 for p in pixels[:ring_pixels])]
+
+    panel = pixels[ring_pixels:ring_pixels + width * height]
+    if width and len(panel) == width * height:
+        # Panels are wired serpentine; odd rows run right to left.
+        rows = []
+        for y in range(height):
+            row = panel[y * width:(y + 1) * width]
+            rows.append(row[::-1] if y & 1 else row)
+        for y in range(0, height, 2):
+            bottom = rows[y + 1] if y + 1 < height else [(0, 0, 0)] * width
+            lines.append(''.join(block(t, b)
+                                 for t, b in zip(rows[y], bottom)))
+    return '\x1b[H' + '\x1b[0m\n'.join(lines) + '\x1b[0m\n'
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--name', default='lamp')
+    parser.add_argument('--fps', type=float, default=30)
+    parser.add_argument('--once', action='store_true')
+    args = parser.parse_args()
+
+    with open('/dev/shm/' + args.name, 'r+b') as f:
+        mem = mmap.mmap(f.fileno(), 0)
+
+    (magic, version, slots, frame_bytes, width, height,
+     _, _, _, _) = HEADER.unpack_from(mem, 0)
+    if magic != MAGIC or version != VERSION:
+        sys.exit('no viewer output in /dev/shm/%s' % args.name)
+    slot_bytes = (SLOT.size + frame_bytes + 7) & ~7
+
+    if args.once and struct.unpack_from('<I', mem, WRITTEN)[0] == 0:
+        sys.exit('no frames in /dev/shm/%s' % args.name)
+    sys.stdout.write('\x1b[2J')
+    shown = 0
+    while True:
+        written = struct.unpack_from('<I', mem, WRITTEN)[0]
+        if written != shown:
+            frame = written - 1
+            base = HEADER.size + (frame % slots) * slot_bytes
+            sequence, ms, ring_pixels, _, _ = SLOT.unpack_from(mem, base)
+            data = mem[base + SLOT.size:base + SLOT.size + frame_bytes]
+            # If the slot changed while it was being copied, try again.
+            if (sequence == 2 * written and
+                    struct.unpack_from('<I', mem, base)[0] == sequence):
+                sys.stdout.write(draw(data, ring_pixels, width, height))
+                sys.stdout.write('%8.1fs frame %d\n' % (ms / 1000.0, frame))
+                sys.stdout.flush()
+                shown = written
+                struct.pack_into('<I', mem, READ_UP_TO, written)
+                if args.once:
+                    return
+                continue
+        time.sleep(1 / args.fps)
+
+
+if __name__ == '__main__':
+    main()
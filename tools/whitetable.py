@@ -0,0 +1,70 @@
+#!/usr/bin/env python
+# Generates src/whitetable.h, the tunable-white table used by modeLight.
+#
+# Each entry mixes the W die with as little R, G and B as possible to hit the
+# target color temperature. The target colors come from Tanner Helland's
+# blackbody approximation; WHITE_DIE_K is the temperature of the W die in our
+# LEDs. If you measure the fixture with a colorimeter, put the measured die
+# colors in here instead and regenerate.
+#
+# usage: python tools/whitetable.py > src/whitetable.h
+
+import math
+
+WHITE_DIE_K = 4000
+MIN_K = 2200
+MAX_K = 6500
+STEP_K = 100
+
+
+def blackbody(kelvin):
+    t = kelvin / 100.0
+    if t <= 66:
+        r = 255.0
+        g = 99.4708025861 * math.log(t) - 161.1195681661
+    else:
+        r = 329.698727446 * math.pow(t - 60, -0.1332047592)
+        g = 288.1221695283 * math.pow(t - 60, -0.0755148492)
+    if t >= 66:
+        b = 255.0
+    elif t <= 19:
+        b = 0.0
+    else:
+        b = 138.5177312231 * math.log(t - 10) - 305.0447927307
+    return [min(max(c, 0.0), 255.0) for c in (r, g, b)]
+
+
+def mix(kelvin):
+    target = blackbody(kelvin)
+    die = blackbody(WHITE_DIE_K)
+    # Use as much of the W die as we can without overshooting any channel,
+    # and make up the difference with the color dies.
+    w = min(1.0, *[t / d for t, d in zip(target, die) if d > 0])
+    rgb = [t - w * d for t, d in zip(target, die)]
+    scale = 255.0 / max(w * 255.0, *rgb)
+    return [int(round(c * scale)) for c in rgb] + [int(round(w * 255.0 * scale))]
+
+
+def main():
+    print("// Generated by tools/whitetable.py, don't edit by hand.")
+    print("//")
+    print("// R, G, B, W mix for each color temperature from %dK to %dK in %dK"
+          % (MIN_K, MAX_K, STEP_K))
+    print("// steps, assuming a %dK white die." % WHITE_DIE_K)
+    print("#pragma once")
+    print("#include \"hot.h\"")
+    print("")
+    print("const uint16_t WhiteDieKelvin = %d;" % WHITE_DIE_K)
+    print("const uint16_t WhiteMinKelvin = %d;" % MIN_K)
+    print("const uint16_t WhiteMaxKelvin = %d;" % MAX_K)
+    print("const uint16_t WhiteStepKelvin = %d;" % STEP_K)
+    print("")
+    print("// modeLight reads this every frame while it changes temperature.")
+    print("LAMP_HOT_DATA const uint8_t whiteTable[][4] = {")
+    for k in range(MIN_K, MAX_K + 1, STEP_K):
+        print("    {%3d, %3d, %3d, %3d}, // %dK" % (tuple(mix(k)) + (k,)))
+    print("};")
+
+
+if __name__ == '__main__':
+    main()